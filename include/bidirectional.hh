@@ -0,0 +1,157 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MARKOV_BIDIRECTIONAL_HH_INCL
+#define MARKOV_BIDIRECTIONAL_HH_INCL
+
+#include <model.hh>
+#include <string_view>
+#include <vector>
+
+namespace markov {
+
+class source;
+
+/*!
+ * \brief A pair of models, one of the text read forwards and one of
+ * it read backwards, for growing text both ways from a word.
+ *
+ * Both models are trained in the same pass.  Each word is interned
+ * once, in the forward model's vocabulary, and the same window of
+ * ids that gives the forward model a prefix and its successor gives
+ * the backward model the reversed prefix and the word before it.  The
+ * backward model's prefixes are in reading order backwards: the
+ * prefix (c, b) is followed by a where the text read "a b c".
+ *
+ * \see model
+ */
+class bidirectional {
+
+public:
+
+  /*!
+   * \brief The constructor.
+   *
+   * \param len The length of the prefix used in both models, which
+   * must be at least one.
+   */
+  explicit bidirectional(std::size_t len = 2);
+
+  /*!
+   * \brief Add a word to both models, interning it in the vocabulary.
+   *
+   * \param w The word to add.
+   */
+  void add(std::string_view w);
+
+  /*!
+   * \brief Add a run of token ids from the vocabulary.
+   *
+   * document_break clears the current prefix; any other id that is
+   * not in the vocabulary is ignored.
+   *
+   * \param ids The ids to add.
+   * \param n The number of ids.
+   */
+  void add(const token *ids, std::size_t n);
+
+  /*!
+   * \brief Add words from a block source to both models.
+   *
+   * \param in The source to read blocks from.
+   * \param resetprefix Whether or not to clear the current prefix at
+   * the start of each document.
+   */
+  void add(source& in, bool resetprefix = false);
+
+  /*!
+   * \brief Clear the current prefix, so the next word added starts a
+   * new prefix.
+   */
+  void reset();
+
+  /*!
+   * \brief Freeze both models once training is done.
+   *
+   * This also copies the vocabulary to the backward model, whose
+   * words() is empty until then, and groups the backward model's
+   * states by the first word of their prefix, so that generate()
+   * finds a seed's starting state in constant time.
+   */
+  void freeze();
+
+  /*!
+   * \brief Return the model of the text read forwards.
+   */
+  const model& forward() const;
+
+  /*!
+   * \brief Return the model of the text read backwards.
+   */
+  const model& backward() const;
+
+  /*!
+   * \brief Return the vocabulary shared by both models.
+   */
+  const vocabulary& words() const;
+
+  /*!
+   * \brief Generate text around a seed word.
+   *
+   * The walk starts from a random state of the backward model whose
+   * prefix begins with the seed: a place in the training text where
+   * the seed ended prefixLength() words that had a word before them.
+   * From there the backward model generates the words before the
+   * seed, and the forward model, from the same words read forwards,
+   * the words after it.  Either side stops early at a dead end.
+   *
+   * The model must be frozen.
+   *
+   * \param seed The id of the seed word.
+   * \param before The most words to generate before the seed.
+   * \param after The most words to generate after the seed.
+   * \param out Cleared, then filled with the words in reading order.
+   * \param at If not NULL, receives the index of the seed in out.
+   * \return False if there is no such place, in which case out is
+   * empty.
+   */
+  bool generate(token seed, std::size_t before, std::size_t after,
+                std::vector<token>& out, std::size_t *at = NULL) const;
+
+  /*!
+   * \brief Generate text around a seed word given as text.
+   *
+   * \see generate(token, std::size_t, std::size_t, std::vector<token>&,
+   * std::size_t *) const
+   */
+  bool generate(std::string_view seed, std::size_t before, std::size_t after,
+                std::vector<token>& out, std::size_t *at = NULL) const;
+
+private:
+  model fwd;
+  model bwd;
+  std::vector<token> reversed;
+  std::vector<std::size_t> seed_at;
+  std::vector<model::state> seeds;
+  void push(token t);
+  model::state seedState(token seed) const;
+};
+
+}
+
+#endif // MARKOV_BIDIRECTIONAL_HH_INCL
@@ -19,10 +19,13 @@
 #ifndef MARKOV_CHAIN_HH_INCL
 #define MARKOV_CHAIN_HH_INCL
 
+#include <cstdint>
 #include <deque>
 #include <vector>
 #include <map>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <istream>
 #include <ostream>
 
@@ -31,6 +34,10 @@
  */
 namespace markov {
 
+class source;
+class fd_sink;
+class philox;
+
 /*!
  * \brief A class to implement a Markov chain text generator.
  *
@@ -66,6 +73,32 @@ public:
    */
   void add(const std::string& s);
 
+  /*!
+   * \brief Add a string to the chain, taking it over.
+   *
+   * This saves a copy over add(const std::string&) when the caller
+   * no longer needs the string.
+   *
+   * \param s The std::string to add.
+   */
+  void add(std::string&& s);
+
+  /*!
+   * \brief Add a range of words to the chain.
+   *
+   * The elements may be std::string, std::string_view or C strings.
+   * Wrap the iterators in std::make_move_iterator to have strings
+   * moved into the chain rather than copied.
+   *
+   * \param first The first word to add.
+   * \param last The end of the range.
+   */
+  template <class InputIterator>
+  void add(InputIterator first, InputIterator last) {
+    for (; first != last; ++first)
+      this->addWord(*first);
+  }
+
   /*!
    * \brief Add strings from a input stream to the chain.
    *
@@ -75,6 +108,49 @@ public:
    */
   void add(std::istream& in, bool resetprefix = false);
 
+  /*!
+   * \brief Add strings from a block source to the chain.
+   *
+   * The blocks are split into words on whitespace, just as reading
+   * from a stream does, but without the stream overhead.  Words never
+   * run from one document into the next.
+   *
+   * \param in The source to read blocks from.
+   * \param resetprefix Whether or not to clear the current prefix at
+   * the start of each document.
+   */
+  void add(source& in, bool resetprefix = false);
+
+  /*!
+   * \brief Clear the current prefix, so the next word added starts a
+   * new prefix.
+   */
+  void reset();
+
+  /*!
+   * \brief Add the entries of another chain to this one.
+   *
+   * The suffixes of each prefix in other are appended to the
+   * suffixes of the same prefix in this chain.  This is how chains
+   * trained separately, for instance on different threads, are
+   * combined.  The current prefix is not changed.
+   *
+   * \param other The chain to merge into this one.
+   * \return True on success, false if the prefix lengths differ.
+   */
+  bool merge(const chain& other);
+
+  /*!
+   * \brief Move the entries of another chain into this one.
+   *
+   * This is the same as the other merge method, but the suffix
+   * strings are moved rather than copied.  other is left empty.
+   *
+   * \param other The chain to merge into this one.
+   * \return True on success, false if the prefix lengths differ.
+   */
+  bool merge(chain&& other);
+
   /*!
    * \brief Generate scrambled text from the chain starting with a
    * given prefix.
@@ -103,6 +179,57 @@ public:
    */
   void generate(std::ostream& s, std::size_t nwords, bool tryhard = false);
 
+  /*!
+   * \brief Generate scrambled text from the chain starting with a
+   * given prefix, writing it to a sink.
+   *
+   * The text is the same as the ostream version writes, ending in a
+   * newline, but the words are handed to the sink by reference into
+   * the chain, so they are neither formatted nor, when long, copied.
+   *
+   * \warning This method is not thread safe.
+   *
+   * \param s Sink to write the scrambled text to.
+   * \param nwords The number of words to write.
+   * \param pref The prefix to start at.
+   * \param tryhard If true, pick a random prefix when we reach the
+   * last prefix and we still want output
+   */
+  void generate(fd_sink& s, std::size_t nwords, const prefix& pref,
+    bool tryhard = false);
+
+  /*!
+   * \brief Generate scrambled text from the chain starting with a
+   * given prefix, drawing from a stream of its own.
+   *
+   * The words are chosen as the other generate methods choose them,
+   * but with rng in place of the class wide generator, so the text
+   * depends only on the chain, the prefix and the stream.  Seeding a
+   * philox costs nothing, so a caller can give every request its own
+   * (seed, stream) pair and answer it the same way every time.
+   *
+   * \warning This method is not thread safe.
+   *
+   * \param s Stream to write the scrambled text to.
+   * \param nwords The number of words to write.
+   * \param pref The prefix to start at.
+   * \param tryhard If true, pick a random prefix when we reach the
+   * last prefix and we still want output
+   * \param rng The stream to draw from.
+   */
+  void generate(std::ostream& s, std::size_t nwords, const prefix& pref,
+    bool tryhard, philox& rng);
+
+  /*!
+   * \brief Generate scrambled text to a sink, drawing from a stream of
+   * its own.
+   *
+   * \see generate(std::ostream&, std::size_t, const prefix&, bool,
+   * philox&)
+   */
+  void generate(fd_sink& s, std::size_t nwords, const prefix& pref,
+    bool tryhard, philox& rng);
+
   /*!
    * \brief Output the chain to a stream in a format that can easily
    * be read back in.
@@ -164,6 +291,13 @@ public:
    */
   prefix randomPrefix();
 
+  /*!
+   * \brief Return a random prefix from the chain, drawn from a stream.
+   *
+   * \param rng The stream to draw from.
+   */
+  prefix randomPrefix(philox& rng);
+
   /*!
    * \brief Check if a chain instance has a prefix matching the
    * argument.
@@ -196,8 +330,8 @@ public:
    * Client code generally does not need to use this class method.
    * The other members will call it if necessary.  It is there,
    * however, if you do want to change the seed on the pseudo-random
-   * number generator for some reason.  Keep in mind that it doesn't
-   * let you pick the seed.
+   * number generator for some reason.  The seed comes from
+   * entropy(); use setSeed() to pick it yourself.
    *
    * Also, if the isSeeded static method would return true, this
    * method will not actually do anything unless the force argument is
@@ -210,6 +344,31 @@ public:
    */
   static void seed(bool force = false);
 
+  /*!
+   * \brief Seed the class wide random number generator with a given
+   * value.
+   *
+   * The same value gives the same text from the same chain, which is
+   * what tests and reproducible runs want.  Afterwards isSeeded()
+   * returns true, so the other members will not reseed it.
+   *
+   * \warning This method is not thread safe.
+   *
+   * \param value The seed.
+   */
+  static void setSeed(unsigned int value);
+
+  /*!
+   * \brief Return a fresh random seed.
+   *
+   * The seed comes from getrandom() where configure found it, or
+   * else from RANDOM_DEVICE, which is opened on the first call and
+   * kept open; failing both, it is made from the time.  Either way it
+   * is cheap enough to call for every request, to seed a philox
+   * stream or to reseed the class wide generator.
+   */
+  static std::uint64_t entropy();
+
 protected:
 
   /*!
@@ -250,6 +409,15 @@ private:
   std::size_t prefix_len;
   static bool is_seeded;
   bool parseLine(std::string line);
+  template <class Emit, class Draw>
+  void walk(std::size_t nwords, const prefix& pref, bool tryhard,
+            Emit emit, Draw& draw);
+  template <class Draw>
+  prefix pickPrefix(Draw& draw);
+  void addWord(const std::string& s) { this->add(s); }
+  void addWord(std::string&& s) { this->add(std::move(s)); }
+  void addWord(std::string_view s) { this->add(std::string(s)); }
+  void addWord(const char *s) { this->add(std::string(s)); }
 
 };
 
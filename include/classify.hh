@@ -0,0 +1,169 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MARKOV_CLASSIFY_HH_INCL
+#define MARKOV_CLASSIFY_HH_INCL
+
+#include <model.hh>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace markov {
+
+class source;
+
+/*!
+ * \brief Many Markov chains over one vocabulary, for classifying
+ * documents by which chain explains them best.
+ *
+ * Every class, such as an author or a category, has its own chain,
+ * but they all share one model, which holds the vocabulary, the
+ * prefixes and the successors seen in any class.  For each prefix and
+ * successor the counts of all classes sit next to each other, found
+ * by the successor's position in the model, so a document is
+ * tokenized once, each prefix and successor is looked up once, and
+ * the scores of all classes are updated together in a loop the
+ * compiler can vectorize.
+ *
+ * A class's score is the log-likelihood of the document under its
+ * chain.  Transitions a class never saw are smoothed with that
+ * class's add-one unigram distribution, weighted Witten-Bell fashion
+ * by the number of distinct words that followed the prefix, so a
+ * single unseen word does not rule a class out.
+ */
+class classifier {
+
+public:
+
+  /*!
+   * \brief The constructor.
+   *
+   * \param names The names of the classes.  Class i is names[i].
+   * \param len The length of the prefix used in the chains, which
+   * must be at least one.
+   */
+  explicit classifier(const std::vector<std::string>& names,
+                      std::size_t len = 2);
+
+  /*!
+   * \brief Return the number of classes.
+   */
+  std::size_t classes() const;
+
+  /*!
+   * \brief Return the name of a class.
+   *
+   * \param c A class less than classes().
+   */
+  const std::string& label(std::size_t c) const;
+
+  /*!
+   * \brief Return the value of the prefix length member.
+   */
+  std::size_t prefixLength() const;
+
+  /*!
+   * \brief Return the shared vocabulary.
+   */
+  const vocabulary& words() const;
+
+  /*!
+   * \brief Add a word to a class's chain.
+   *
+   * \param c The class.
+   * \param w The word to add.
+   */
+  void add(std::size_t c, std::string_view w);
+
+  /*!
+   * \brief Add the documents of a block source to a class's chain.
+   *
+   * The prefix is cleared at the start of each document.
+   *
+   * \param c The class.
+   * \param in The source to read blocks from.
+   */
+  void add(std::size_t c, source& in);
+
+  /*!
+   * \brief Clear the current prefix, so the next word added starts a
+   * new prefix.
+   */
+  void reset();
+
+  /*!
+   * \brief Score a token sequence against every class.
+   *
+   * Ids that are not in the vocabulary are skipped, and break the
+   * prefix they fall in.
+   *
+   * \param ids The sequence to score, in ids of words().
+   * \param n The number of ids.
+   * \param scores An array of classes() values that receives the
+   * natural log-likelihood of the sequence under each class.
+   */
+  void score(const token *ids, std::size_t n, double *scores) const;
+
+  /*!
+   * \brief Score every document of a source against every class.
+   *
+   * The text is split into words the same way training does.  The
+   * scores of document d are stored at scores[d * classes()] and the
+   * classes() values after it.  A document with no words in the
+   * vocabulary, including one that produced no blocks, is left at
+   * zero for every class; its scores say nothing, and scored tells
+   * such documents apart.
+   *
+   * \param in The source to read.
+   * \param scores Resized to hold the scores of every document.
+   * \param scored If not NULL, resized to hold the number of words
+   * scored in each document.
+   * \return The number of documents.
+   */
+  std::size_t score(source& in, std::vector<double>& scores,
+                    std::vector<std::size_t> *scored = NULL) const;
+
+  /*!
+   * \brief Return the class with the highest score.
+   *
+   * \param scores classes() scores, as filled in by score.
+   */
+  std::size_t best(const double *scores) const;
+
+private:
+  std::vector<std::string> names;
+  std::size_t nclasses;
+  std::size_t prefix_len;
+  model chains;
+  std::vector<std::vector<std::uint32_t> > counts;
+  std::vector<std::uint32_t> totals;
+  std::vector<std::uint32_t> distinct;
+  std::vector<std::uint32_t> unigrams;
+  std::vector<std::uint64_t> ntokens;
+  std::vector<token> window;
+  class accumulator;
+  void addToken(std::size_t c, token t);
+  void scoreToken(const token *window, std::size_t wlen, token t,
+                  accumulator& acc) const;
+};
+
+}
+
+#endif // MARKOV_CLASSIFY_HH_INCL
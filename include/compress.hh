@@ -0,0 +1,157 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MARKOV_COMPRESS_HH_INCL
+#define MARKOV_COMPRESS_HH_INCL
+
+#include <source.hh>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace markov {
+
+/*!
+ * \brief A source that decompresses files on a separate thread.
+ *
+ * Each file is a document.  The format of each file is detected from
+ * its first bytes: gzip (or zlib) data is inflated with zlib,
+ * Zstandard data with libzstd, and anything else is passed through
+ * unchanged.  Which compressed formats are available depends on the
+ * libraries found at configure time; see supports.
+ *
+ * A background thread decompresses straight into a ring of blocks,
+ * and next hands those blocks to the consumer, so decompression of
+ * later input overlaps with training on earlier input.  The file name
+ * "-" reads standard input.
+ *
+ * Files that cannot be opened or decoded are reported by the errors
+ * method once next has returned false.  Text decoded before an error
+ * is still handed out.
+ */
+class compressed_reader : public source {
+
+public:
+
+  /*!
+   * \brief The input formats understood by the reader.
+   */
+  enum format {
+    plain,  //!< Uncompressed text.
+    gzip,   //!< gzip or zlib data.
+    zstd    //!< Zstandard data.
+  };
+
+  /*!
+   * \brief The constructor.
+   *
+   * The decompression thread starts at once.
+   *
+   * \param files The names of the files to read, in order.
+   * \param block_size The size of each block in the ring in bytes.
+   * \param nblocks The number of blocks in the ring.
+   */
+  compressed_reader(const std::vector<std::string>& files,
+                    std::size_t block_size = 1 << 18, unsigned nblocks = 8);
+
+  /*!
+   * \brief The destructor.
+   *
+   * Stops the decompression thread.
+   */
+  ~compressed_reader();
+
+  compressed_reader(const compressed_reader&) = delete;
+  compressed_reader& operator=(const compressed_reader&) = delete;
+
+  bool next(buffer& buf);
+
+  /*!
+   * \brief Return the number of decompressed bytes handed out so far.
+   */
+  unsigned long long bytes() const;
+
+  /*!
+   * \brief Return the names of files that could not be opened or
+   * decoded.
+   *
+   * \warning Only call this after next has returned false.
+   */
+  const std::vector<std::string>& errors() const;
+
+  /*!
+   * \brief Check whether this build can decode a format.
+   *
+   * \param f The format to check.
+   * \return True if files in format f can be read.
+   */
+  static bool supports(format f);
+
+  /*!
+   * \brief Guess the format of data from its first bytes.
+   *
+   * \param data The start of the data.
+   * \param size The number of bytes available at data.
+   * \return The detected format, plain if it is not recognized.
+   */
+  static format detect(const char *data, std::size_t size);
+
+  /*!
+   * \brief Check whether a file name has the extension of a
+   * compressed format (.gz, .z, .zst or .zstd).
+   *
+   * \param name The file name to check.
+   */
+  static bool compressedName(const std::string& name);
+
+private:
+  struct block {
+    char *data;
+    std::size_t size;
+    std::size_t document;
+    bool first;
+    bool last;
+  };
+
+  std::vector<std::string> files;
+  std::size_t block_size;
+  std::vector<block> ring;
+  std::size_t produce_pos;
+  std::size_t consume_pos;
+  std::size_t full;
+  bool holding;
+  bool done;
+  bool stopping;
+  unsigned long long nbytes;
+  std::vector<std::string> failed;
+  std::mutex mutex;
+  std::condition_variable not_full;
+  std::condition_variable not_empty;
+  std::thread producer;
+
+  void produce();
+  bool decodeFile(std::size_t f);
+  block *acquire(std::size_t f, bool first);
+  void publish(bool last);
+};
+
+}
+
+#endif // MARKOV_COMPRESS_HH_INCL
@@ -0,0 +1,141 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MARKOV_CONSTRAINTS_HH_INCL
+#define MARKOV_CONSTRAINTS_HH_INCL
+
+#include <model.hh>
+#include <cstdint>
+#include <vector>
+
+namespace markov {
+
+/*!
+ * \brief A set of token ids, one bit per id.
+ *
+ * A word_set is how a request names the words it will not accept, or
+ * the words that may end a sample.  Testing an id is one load and a
+ * mask.
+ */
+class word_set {
+
+public:
+
+  /*!
+   * \brief The constructor.
+   *
+   * \param n The number of ids to make room for; the set grows as
+   * larger ids are inserted.
+   */
+  explicit word_set(std::size_t n = 0);
+
+  /*!
+   * \brief Add an id to the set.
+   *
+   * \param t The id; no_token and document_break are ignored.
+   */
+  void insert(token t);
+
+  /*!
+   * \brief Remove an id from the set.
+   *
+   * \param t The id.
+   */
+  void erase(token t);
+
+  /*!
+   * \brief Check whether an id is in the set.
+   *
+   * \param t The id.
+   */
+  bool contains(token t) const {
+    std::size_t i = t >> 6;
+    return i < this->bits.size() && (this->bits[i] >> (t & 63) & 1);
+  }
+
+  /*!
+   * \brief Check whether the set is empty.
+   */
+  bool empty() const;
+
+  /*!
+   * \brief Remove every id from the set.
+   */
+  void clear();
+
+private:
+  std::vector<std::uint64_t> bits;
+};
+
+/*!
+ * \brief Which states of a model can reach a word that ends a sample.
+ *
+ * For each state, the fewest words that must be generated from it to
+ * produce one of the terminal words, found once by a breadth-first
+ * search backwards from the states that a terminal word follows.
+ * A walk that only moves to states whose distance fits in the words
+ * it has left is sure to end on a terminal word in time.
+ *
+ * The model must not change while the endings are in use.
+ *
+ * \see sampler
+ */
+class endings {
+
+public:
+
+  /*!
+   * \brief A distance for states that cannot reach a terminal word.
+   */
+  static constexpr std::uint32_t unreachable = 0xffffffff;
+
+  /*!
+   * \brief Work out the distances.
+   *
+   * \param mod The model.
+   * \param ends The terminal words.
+   */
+  endings(const model& mod, const word_set& ends);
+
+  /*!
+   * \brief Check whether a word is terminal.
+   *
+   * \param t The id of the word.
+   */
+  bool terminal(token t) const {
+    return this->terminals.contains(t);
+  }
+
+  /*!
+   * \brief Return the fewest words that reach a terminal word from a
+   * state, counting the terminal word, or unreachable.
+   *
+   * \param s A state of the model, or no_state, which is unreachable.
+   */
+  std::uint32_t distance(model::state s) const {
+    return s < this->dist.size() ? this->dist[s] : unreachable;
+  }
+
+private:
+  word_set terminals;
+  std::vector<std::uint32_t> dist;
+};
+
+}
+
+#endif // MARKOV_CONSTRAINTS_HH_INCL
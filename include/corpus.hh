@@ -0,0 +1,126 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MARKOV_CORPUS_HH_INCL
+#define MARKOV_CORPUS_HH_INCL
+
+#include <source.hh>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace markov {
+
+/*!
+ * \brief A source that reads a list of files with many reads in
+ * flight at once.
+ *
+ * Each file is a document.  The files are split into fixed size
+ * blocks and up to depth blocks, possibly from several files, are
+ * being read at any time, so that the storage device is kept busy
+ * while the consumer tokenizes earlier blocks.  Blocks are still
+ * handed out strictly in file and offset order.
+ *
+ * On Linux the reads are issued through io_uring when the kernel
+ * allows it.  Otherwise, a small pool of threads calling pread does
+ * the same job.
+ *
+ * Pipes, FIFOs and other files that are not regular are read
+ * sequentially, one block at a time, as they have no size to plan
+ * reads by.
+ *
+ * Files that cannot be opened or read are skipped and reported by
+ * the errors method.  Empty regular files produce no blocks.
+ */
+class corpus_reader : public source {
+
+public:
+
+  /*!
+   * \brief The constructor.
+   *
+   * No reads are started until the first call to next.
+   *
+   * \param files The names of the files to read, in order.
+   * \param block_size The size of each read in bytes.
+   * \param depth The maximum number of reads in flight.
+   * \param use_uring If false, use the pread thread pool even when
+   * io_uring is available.
+   */
+  corpus_reader(const std::vector<std::string>& files,
+                std::size_t block_size = 1 << 18, unsigned depth = 32,
+                bool use_uring = true);
+
+  /*!
+   * \brief The destructor.
+   *
+   * Waits for outstanding reads and closes any open files.
+   */
+  ~corpus_reader();
+
+  corpus_reader(const corpus_reader&) = delete;
+  corpus_reader& operator=(const corpus_reader&) = delete;
+
+  bool next(buffer& buf);
+
+  /*!
+   * \brief Return the name of the mechanism used for reading, either
+   * "io_uring" or "pread".
+   */
+  const char *backend() const;
+
+  /*!
+   * \brief Return the number of bytes handed out so far.
+   */
+  unsigned long long bytes() const;
+
+  /*!
+   * \brief Return the names of files that could not be opened or
+   * read.
+   */
+  const std::vector<std::string>& errors() const;
+
+private:
+  struct slot;
+  class engine;
+  class uring_engine;
+  class pool_engine;
+
+  std::vector<std::string> files;
+  std::size_t block_size;
+  std::vector<slot> slots;
+  std::unique_ptr<engine> io;
+  std::size_t head;
+  std::size_t inflight;
+  bool holding;
+  std::size_t next_file;
+  std::size_t cur_file;
+  int cur_fd;
+  bool cur_stream;
+  unsigned long long cur_off;
+  unsigned long long cur_size;
+  unsigned long long nbytes;
+  std::vector<std::string> failed;
+  bool plan(slot& s);
+  void fill(slot& s);
+  void release(slot& s);
+};
+
+}
+
+#endif // MARKOV_CORPUS_HH_INCL
@@ -0,0 +1,197 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MARKOV_EVALUATE_HH_INCL
+#define MARKOV_EVALUATE_HH_INCL
+
+#include <model.hh>
+#include <string>
+#include <vector>
+
+namespace markov {
+
+class source;
+
+/*!
+ * \brief A model with smoothed probabilities for unseen transitions.
+ *
+ * The probability of a word after a prefix is interpolated with the
+ * probability after the prefix minus its first word, and so on down
+ * to the unigram distribution, using Witten-Bell weights: the more
+ * distinct words have followed a prefix, the more weight goes to the
+ * shorter one.  The unigram distribution is add-one smoothed, so every
+ * word in the vocabulary has a non-zero probability after any prefix.
+ *
+ * The shorter models are built by model::reduce when the smoothed
+ * model is constructed.  The underlying model must outlive it and
+ * must not be changed.
+ */
+class smoothed_model {
+
+public:
+
+  /*!
+   * \brief The constructor.
+   *
+   * \param m The trained model.
+   */
+  explicit smoothed_model(const model& m);
+
+  /*!
+   * \brief Return the underlying model.
+   */
+  const model& base() const;
+
+  /*!
+   * \brief Return the smoothed natural log-probability of a word.
+   *
+   * \param history The words before w, oldest first.  Ids that are
+   * not in the vocabulary are allowed and never match a prefix.
+   * \param hlen The number of ids in history.  Only the last
+   * prefixLength() of them are used.
+   * \param w The id of the word, which must be in the vocabulary.
+   * \param context If not NULL, receives the length of the longest
+   * tail of the history that is a prefix in the models.
+   * \param match If not NULL, receives the length of the longest tail
+   * of the history that has been followed by w.
+   */
+  double logProb(const token *history, std::size_t hlen, token w,
+                 std::size_t *context = NULL,
+                 std::size_t *match = NULL) const;
+
+private:
+  const model& full;
+  std::vector<model> shorter;
+  std::vector<std::uint64_t> unigrams;
+  std::uint64_t ntokens;
+};
+
+/*!
+ * \brief Counters reported by evaluate.
+ */
+struct evaluation {
+
+  /*!
+   * \brief The number of words read.
+   */
+  unsigned long long tokens;
+
+  /*!
+   * \brief The number of words read that are not in the vocabulary.
+   * They are not scored.
+   */
+  unsigned long long oov;
+
+  /*!
+   * \brief The number of words that had a full prefix before them,
+   * but the prefix was never followed by anything in training, so an
+   * unsmoothed model could not go on.
+   */
+  unsigned long long dead_ends;
+
+  /*!
+   * \brief The number of words that had a full, known prefix before
+   * them but never followed it in training.
+   */
+  unsigned long long unseen;
+
+  /*!
+   * \brief The number of words scored.
+   */
+  unsigned long long scored;
+
+  /*!
+   * \brief The sum of the natural log-probabilities of the scored
+   * words.
+   */
+  double logprob;
+
+  /*!
+   * \brief The number of bytes read.
+   */
+  unsigned long long bytes;
+
+  /*!
+   * \brief The wall clock time taken, in seconds.
+   */
+  double seconds;
+
+  /*!
+   * \brief The names of files that could not be opened or read.
+   */
+  std::vector<std::string> errors;
+
+  /*!
+   * \brief Return the perplexity of the scored words.
+   */
+  double perplexity() const;
+
+  /*!
+   * \brief Return the fraction of words read that are not in the
+   * vocabulary.
+   */
+  double oovRate() const;
+
+  /*!
+   * \brief Return the fraction of scored words that hit a dead end.
+   */
+  double deadEndRate() const;
+};
+
+/*!
+ * \brief Evaluate a model on held-out text from a source.
+ *
+ * The text is split into words the same way training does, and the
+ * history is reset at the start of each document.  Every word in the
+ * vocabulary is scored, including the first words of a document with
+ * a shorter history.
+ *
+ * \param m The smoothed model.
+ * \param in The source of held-out text.
+ * \return Counters for the run.  The errors member is left empty.
+ */
+evaluation evaluate(const smoothed_model& m, source& in);
+
+/*!
+ * \brief Evaluate a model on held-out files in parallel.
+ *
+ * Each file is a document.  Worker threads take the files in
+ * batches, each reading its batch through a corpus_reader, or a
+ * compressed_reader when the batch holds compressed files, and the
+ * counters are added up at the end.
+ *
+ * With more than one thread, an uncompressed regular file of a few
+ * megabytes or more is instead split into byte ranges that are
+ * scored in parallel.  Ranges are cut at whitespace, and each starts
+ * with the history the words before it would have left, so the
+ * counters are those of reading the file whole.
+ *
+ * \param m The smoothed model.
+ * \param files The held-out files.
+ * \param threads The number of worker threads, or zero for one per
+ * CPU.
+ * \param batch The number of files a worker takes at a time.
+ * \return Counters for the run.
+ */
+evaluation evaluate(const smoothed_model& m,
+                    const std::vector<std::string>& files,
+                    unsigned threads = 0, std::size_t batch = 16);
+
+}
+
+#endif // MARKOV_EVALUATE_HH_INCL
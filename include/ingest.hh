@@ -0,0 +1,121 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MARKOV_INGEST_HH_INCL
+#define MARKOV_INGEST_HH_INCL
+
+#include <chain.hh>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace markov {
+
+/*!
+ * \brief Counters reported by ingest.
+ */
+struct ingest_stats {
+
+  /*!
+   * \brief The number of files trained.
+   */
+  std::size_t files;
+
+  /*!
+   * \brief The number of bytes read from those files.
+   */
+  unsigned long long bytes;
+
+  /*!
+   * \brief The wall clock time taken, in seconds, including merging.
+   */
+  double seconds;
+
+  /*!
+   * \brief The names of files that could not be opened or read.
+   */
+  std::vector<std::string> errors;
+
+  /*!
+   * \brief Return the number of files trained per second.
+   */
+  double filesPerSecond() const;
+
+  /*!
+   * \brief Return the number of megabytes (2^20 bytes) read per
+   * second.
+   */
+  double megabytesPerSecond() const;
+};
+
+/*!
+ * \brief List the regular files under a directory.
+ *
+ * Entries that cannot be read are skipped.  The names are sorted so
+ * that repeated runs train the files in the same order.
+ *
+ * \param dir The directory to list.
+ * \param recursive Whether or not to descend into subdirectories.
+ * \return The paths of the files found.
+ */
+std::vector<std::string> listDirectory(const std::string& dir,
+                                       bool recursive = true);
+
+/*!
+ * \brief Read a manifest of file names, one per line.
+ *
+ * Blank lines are ignored.
+ *
+ * \param in The stream to read the manifest from.
+ * \return The file names, in manifest order.
+ */
+std::vector<std::string> readManifest(std::istream& in);
+
+/*!
+ * \brief Train a chain on many files in parallel.
+ *
+ * Worker threads take the files in batches, train a private chain
+ * each with reads kept in flight by a corpus_reader, and the private
+ * chains are merged into c at the end.  The current prefix of c is
+ * not changed.  Batches containing compressed files, as judged by
+ * compressed_reader::compressedName, are read through a
+ * compressed_reader instead.
+ *
+ * With resetprefix set, each file is a separate document and no
+ * prefix ever spans two files.  Otherwise the workers also keep the
+ * first and last prefixLength() words of every file, and after the
+ * merge the transitions that run from one file into the next are
+ * added, so the chain is the one training the files in order would
+ * give.
+ *
+ * \param c The chain to add to.
+ * \param files The files to train on.
+ * \param threads The number of worker threads, or zero for one per
+ * CPU.
+ * \param batch The number of files a worker takes at a time.
+ * \param resetprefix Whether or not to clear the prefix at the start
+ * of each file.
+ * \return Counters for the run.
+ */
+ingest_stats ingest(chain& c, const std::vector<std::string>& files,
+                    unsigned threads = 0, std::size_t batch = 64,
+                    bool resetprefix = true);
+
+}
+
+#endif // MARKOV_INGEST_HH_INCL
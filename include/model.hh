@@ -0,0 +1,602 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MARKOV_MODEL_HH_INCL
+#define MARKOV_MODEL_HH_INCL
+
+#include <prefixes.hh>
+#include <small_list.hh>
+#include <vocabulary.hh>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace markov {
+
+class philox;
+class source;
+class token_file;
+
+/*!
+ * \brief A Markov chain over token ids.
+ *
+ * A model holds the same information as a chain, but words are
+ * interned in a vocabulary and the chain is kept as a hash table from
+ * prefixes of token ids to successor counts.  Training from token
+ * ids, such as a token_file, is pure integer work, and memory use is
+ * a fraction of a chain's.
+ *
+ * Each distinct prefix is a state, numbered from zero in the order
+ * the prefixes were first seen.
+ *
+ * A few prefixes, such as those ending in punctuation, are followed by
+ * thousands of different words.  Once a state has more than a few
+ * dozen successors, a hash index of where each word is in its list is
+ * kept beside it, so training does not scan the list for every word.
+ * Freezing gives such states running sums of their counts, so that
+ * generating from one is a binary search rather than a scan, and the
+ * largest an alias table, so that it takes constant time.
+ *
+ * \see chain
+ */
+class model {
+
+public:
+
+  /*!
+   * \brief Define a type for state numbers.
+   */
+  typedef prefix_table::state state;
+
+  /*!
+   * \brief A state number that never names a state.
+   */
+  static constexpr state no_state = prefix_table::no_state;
+
+  /*!
+   * \brief A word that has followed a prefix and how many times.
+   */
+  struct successor {
+
+    /*!
+     * \brief The id of the word.
+     */
+    token word;
+
+    /*!
+     * \brief The number of times it followed the prefix.
+     */
+    std::uint32_t count;
+  };
+
+  /*!
+   * \brief Define a type for the successors of one state.
+   *
+   * Most prefixes of natural text are only ever followed by one or
+   * two words, so those are kept in the list itself, which is the
+   * size of an empty std::vector, and only longer lists are put on
+   * the heap.
+   */
+  typedef small_list<successor, 2> successor_list;
+
+  /*!
+   * \brief The constructor.
+   *
+   * \param len The length of the prefix used in the model, which must
+   * be at least one.
+   */
+  model(std::size_t len = 2);
+
+  /*!
+   * \brief Add a word, by id, to the model.
+   *
+   * Ids that are not in the vocabulary are ignored.
+   *
+   * \param t The id of the word.
+   */
+  void add(token t);
+
+  /*!
+   * \brief Add a word to the model, interning it in the vocabulary.
+   *
+   * \param w The word to add.
+   */
+  void add(std::string_view w);
+
+  /*!
+   * \brief Add words from a block source to the model.
+   *
+   * The text is split into words just as chain::add(source&, bool)
+   * does.
+   *
+   * \param in The source to read blocks from.
+   * \param resetprefix Whether or not to clear the current prefix at
+   * the start of each document.
+   */
+  void add(source& in, bool resetprefix = false);
+
+  /*!
+   * \brief Add the tokens of a token file to the model.
+   *
+   * If the model's vocabulary is empty, it takes over the file's word
+   * table and the ids are used as they are.  Otherwise each of the
+   * file's words is interned once and the ids are translated through
+   * a table.  No strings are handled per token either way.
+   *
+   * \param f An open token file.
+   * \param resetprefix Whether or not to clear the current prefix at
+   * each document break.
+   */
+  void add(const token_file& f, bool resetprefix = true);
+
+  /*!
+   * \brief Add a run of token ids from the model's own vocabulary.
+   *
+   * document_break clears the current prefix; any other id that is
+   * not in the vocabulary is ignored.
+   *
+   * \param ids The ids to add.
+   * \param n The number of ids.
+   */
+  void add(const token *ids, std::size_t n);
+
+  /*!
+   * \brief Add a run of token ids from an external dictionary.
+   *
+   * This is for callers that tokenize with their own dictionary, or
+   * whose symbols are not text at all.  If the model's vocabulary is
+   * empty, it takes a copy of dict and the ids are used as they are.
+   * Otherwise each dictionary id is interned the first time it is
+   * seen and the translation is remembered for later calls with the
+   * same dictionary, so that words are only hashed once.  A
+   * dictionary may grow between calls, but must not be cleared.
+   *
+   * document_break clears the current prefix; any other id that is
+   * not in dict is ignored.
+   *
+   * \param ids The ids to add.
+   * \param n The number of ids.
+   * \param dict The dictionary the ids come from.
+   */
+  void add(const token *ids, std::size_t n, const vocabulary& dict);
+
+  /*!
+   * \brief Clear the current prefix, so the next word added starts a
+   * new prefix.
+   */
+  void reset();
+
+  /*!
+   * \brief Turn sentence breaks on or off for the words added from
+   * now on.
+   *
+   * While they are on, the prefix is cleared after each word ending
+   * in '.', '!' or '?', so that no transition runs from one sentence
+   * into the next, and generation starts from the start of a
+   * sentence.
+   *
+   * The first prefix after every clear of the prefix, whether by a
+   * sentence break, a document break or reset(), is counted as a
+   * start state whether or not breaks are on.
+   *
+   * \param on Whether to break at sentence ends.
+   */
+  void setSentenceBreaks(bool on);
+
+  /*!
+   * \brief Check whether sentence breaks are on.
+   */
+  bool sentenceBreaks() const;
+
+  /*!
+   * \brief Remove all states, words and the current prefix.
+   */
+  void clear();
+
+  /*!
+   * \brief Return the number of states (distinct prefixes).
+   */
+  std::size_t size() const;
+
+  /*!
+   * \brief Return the value of the prefix length member.
+   */
+  std::size_t prefixLength() const;
+
+  /*!
+   * \brief Return the model's vocabulary.
+   */
+  const vocabulary& words() const;
+
+  /*!
+   * \brief Look up the state for a prefix.
+   *
+   * \param pref prefixLength() token ids.
+   * \return The state, or no_state if the prefix has not been seen.
+   */
+  state find(const token *pref) const;
+
+  /*!
+   * \brief Return the prefix of a state, prefixLength() token ids.
+   *
+   * \param s A state less than size().
+   */
+  const token *prefixOf(state s) const;
+
+  /*!
+   * \brief Return the successors of a state.
+   *
+   * \param s A state less than size().
+   */
+  const successor_list& successors(state s) const;
+
+  /*!
+   * \brief Sort every state's successors, most frequent first.
+   *
+   * A model is frozen once training is done.  top then answers in
+   * time proportional to k.  Ties are broken by id, so the order does
+   * not depend on the order of training.  Adding to a frozen model
+   * thaws it, and drops the sums and alias tables built for states
+   * with many successors.
+   *
+   * \param index Whether to also build an index from each word to the
+   * states whose prefixes contain it, for statesWith and
+   * randomState(token).  The index takes one state number per word of
+   * every prefix, and is dropped when the model thaws.
+   */
+  void freeze(bool index = false);
+
+  /*!
+   * \brief Check whether the model is frozen.
+   */
+  bool frozen() const;
+
+  /*!
+   * \brief Check whether the model has an index from words to states.
+   */
+  bool indexed() const;
+
+  /*!
+   * \brief Return the states whose prefixes contain a word.
+   *
+   * The model must be indexed.
+   *
+   * \param t The id of the word.
+   * \return The first state and past the last, in order; a state
+   * whose prefix holds the word twice is listed once.
+   */
+  std::pair<const state *, const state *> statesWith(token t) const;
+
+  /*!
+   * \brief Return the most frequent successors of a state.
+   *
+   * The probability of each is its count divided by total(s).  On a
+   * frozen model the successors are already in order and are copied;
+   * otherwise they are partially sorted on every call.
+   *
+   * \param s A state less than size().
+   * \param k The number of successors wanted.
+   * \param out An array with room for k successors, which receives
+   * them most frequent first.
+   * \return The number stored, which is less than k if the state has
+   * fewer successors.
+   */
+  std::size_t top(state s, std::size_t k, successor *out) const;
+
+  /*!
+   * \brief Return the number of times any word followed a state.
+   *
+   * \param s A state less than size().
+   */
+  std::uint64_t total(state s) const;
+
+  /*!
+   * \brief Return the number of times a word followed a state.
+   *
+   * \param s A state less than size().
+   * \param t The id of the word.
+   */
+  std::uint32_t count(state s, token t) const;
+
+  /*!
+   * \brief Score a token sequence by its log-probability under the
+   * model.
+   *
+   * The probability of each token after the first prefixLength() is
+   * the fraction of the times its prefix was followed by it.  A token
+   * whose prefix was never seen, or never followed by that token,
+   * has probability zero, and makes the total negative infinity.
+   *
+   * The model is only read, so any number of threads may score
+   * against it at once as long as nothing is being added.
+   *
+   * \param ids The sequence to score.
+   * \param n The number of ids.
+   * \param logprobs If not NULL, an array of n values that receives
+   * the natural log-probability of each token.  The first
+   * prefixLength() tokens, which have no prefix, get 0.
+   * \return The natural log-probability of the whole sequence.
+   */
+  double score(const token *ids, std::size_t n,
+               double *logprobs = NULL) const;
+
+  /*!
+   * \brief Score many token sequences in parallel.
+   *
+   * Sequence i is ids[starts[i]] up to ids[starts[i + 1]].
+   *
+   * \param ids The concatenated sequences.
+   * \param starts nseqs + 1 offsets into ids.
+   * \param nseqs The number of sequences.
+   * \param out An array of nseqs values that receives the score of
+   * each sequence.
+   * \param threads The number of threads to use, or 0 for one per CPU.
+   */
+  void scoreBatch(const token *ids, const std::size_t *starts,
+                  std::size_t nseqs, double *out,
+                  unsigned threads = 0) const;
+
+  /*!
+   * \brief Return a random state.
+   *
+   * \warning This method is not thread safe.
+   *
+   * \return A state, or no_state if the model is empty.
+   */
+  state randomState() const;
+
+  /*!
+   * \brief Return a random state, drawn from a stream.
+   *
+   * \param rng The stream to draw from.
+   * \return A state, or no_state if the model is empty.
+   */
+  state randomState(philox& rng) const;
+
+  /*!
+   * \brief Return a random state whose prefix contains a word.
+   *
+   * An indexed model picks one from the word's list of states; any
+   * other model has to look at every state.
+   *
+   * \warning This method is not thread safe.
+   *
+   * \param t The id of the word.
+   * \return A state, or no_state if no prefix contains the word.
+   */
+  state randomState(token t) const;
+
+  /*!
+   * \brief Return the number of distinct start states.
+   */
+  std::size_t starts() const;
+
+  /*!
+   * \brief Return a random state to start generating from.
+   *
+   * With sentence breaks on, this is a start state, chosen with the
+   * frequency it started a sentence or document in training: in
+   * constant time on a frozen model, from an alias table built by
+   * freeze, and otherwise in time proportional to starts().  With
+   * breaks off, or no start states, it is randomState().
+   *
+   * \warning This method is not thread safe.
+   *
+   * \return A state, or no_state if the model is empty.
+   */
+  state randomStart() const;
+
+  /*!
+   * \brief Return a random state to start generating from, drawn
+   * from a stream.
+   *
+   * \param rng The stream to draw from.
+   * \return A state, or no_state if the model is empty.
+   */
+  state randomStart(philox& rng) const;
+
+  /*!
+   * \brief Generate token ids from the model into a buffer, starting
+   * with a given prefix.
+   *
+   * The ids of the prefix are stored first, followed by words picked
+   * at random in proportion to how often they followed the current
+   * prefix, until nwords ids have been stored.  Nothing is formatted
+   * or allocated per word; vocabulary::join turns the ids back into
+   * text.
+   *
+   * \warning This method is not thread safe.
+   *
+   * \param out A buffer with room for nwords ids.
+   * \param nwords The number of ids to store, prefix included.
+   * \param pref prefixLength() ids to start at.  If NULL or not a
+   * prefix in the model, randomStart() is used.
+   * \param tryhard If true, go on from randomStart() when we reach a
+   * prefix that has never been followed, and keep going.  With
+   * sentence breaks on, the new start's prefix is stored too, so that
+   * every sentence is whole.
+   * \return The number of ids stored, which is less than nwords if
+   * a dead end, such as the end of a sentence, was reached.
+   */
+  std::size_t generate(token *out, std::size_t nwords,
+                       const token *pref = NULL, bool tryhard = false) const;
+
+  /*!
+   * \brief Generate token ids from the model into a buffer, drawing
+   * from a stream.
+   *
+   * This is the same walk as the other generate methods, but every
+   * choice is drawn from rng rather than from the shared generator,
+   * so the output depends only on the stream and any number of
+   * threads may generate at once, each with its own stream.
+   *
+   * \param out A buffer with room for nwords ids.
+   * \param nwords The number of ids to store, prefix included.
+   * \param pref prefixLength() ids to start at, or NULL.
+   * \param tryhard Whether to go on from a new start at a dead end.
+   * \param rng The stream to draw from.
+   * \return The number of ids stored.
+   */
+  std::size_t generate(token *out, std::size_t nwords, const token *pref,
+                       bool tryhard, philox& rng) const;
+
+  /*!
+   * \brief Generate many samples in parallel, reproducibly.
+   *
+   * Sample k is generated with the philox stream (seed, first + k),
+   * so the output is the same for a seed whatever the number of
+   * threads and however the samples are shared out.  A long run can
+   * be generated a batch at a time by passing the number of samples
+   * already made as first.
+   *
+   * \param seed The seed.
+   * \param count The number of samples.
+   * \param nwords The most ids in each sample.
+   * \param out An array of count * nwords ids; sample k starts at
+   * out[k * nwords].
+   * \param lengths An array of count values that receives the length
+   * of each sample.
+   * \param tryhard Whether to go on from a new start at a dead end.
+   * \param threads The number of threads to use, or 0 for one per CPU.
+   * \param pref prefixLength() ids every sample starts at, or NULL
+   * to start each from randomStart().
+   * \param first The stream number of the first sample.
+   */
+  void generateBatch(std::uint64_t seed, std::size_t count,
+                     std::size_t nwords, token *out, std::size_t *lengths,
+                     bool tryhard = false, unsigned threads = 0,
+                     const token *pref = NULL,
+                     std::uint64_t first = 0) const;
+
+  /*!
+   * \brief Generate token ids from the model starting with a given
+   * prefix, appending them to a vector.
+   *
+   * This is the same as generate(token *, std::size_t, const token *,
+   * bool), but appends to out.
+   *
+   * \warning This method is not thread safe.
+   *
+   * \param out The vector to append ids to.
+   * \param nwords The number of ids to append, prefix included.
+   * \param pref prefixLength() ids to start at.  If NULL or not a
+   * prefix in the model, a random prefix is used.
+   * \param tryhard If true, pick a random prefix when we reach a
+   * prefix that has never been followed, and keep going.
+   * \return The number of ids appended.
+   */
+  std::size_t generate(std::vector<token>& out, std::size_t nwords,
+                       const token *pref = NULL, bool tryhard = false) const;
+
+  /*!
+   * \brief Output the model to a stream in the format written by
+   * chain::write, so that chain::read can load it.
+   *
+   * Each successor is written as many times as it was counted.  The
+   * order of the lines and of the suffixes within a line differs from
+   * what chain::write would produce for the same input, but the chain
+   * read back is equivalent.
+   *
+   * With sentence breaks on, the start states follow, one per line:
+   * the prefix, a '^' and the number of times it started a sentence
+   * or document.  chain::read skips these lines.
+   *
+   * \param s The stream to write to.
+   */
+  void write(std::ostream& s) const;
+
+  /*!
+   * \brief Replace the model with one read from a stream in the
+   * format written by chain::write or write.
+   *
+   * The prefix length is taken from the first line, and lines with a
+   * different prefix length are skipped, as chain::read does.
+   * Repeated suffixes are counted.  Start states written by write are
+   * read back, and turn sentence breaks on.
+   *
+   * \param s The stream to read from.
+   */
+  void read(std::istream& s);
+
+  /*!
+   * \brief Build the model with a prefix one word shorter.
+   *
+   * The counts of all states whose prefixes differ only in the first
+   * word are added together, which gives the model training on the
+   * same text at the shorter prefix length would have, apart from
+   * the first word of each document.  The vocabulary is copied, so
+   * ids are the same in both models.
+   *
+   * \return The shorter model, or a copy of this one if the prefix
+   * length is already one.
+   */
+  model reduce() const;
+
+private:
+  friend class bidirectional;
+  friend class classifier;
+  std::size_t prefix_len;
+  vocabulary vocab;
+  prefix_table table;
+  std::vector<successor_list> suffixes;
+  std::vector<std::uint64_t> totals;
+  std::vector<token> window;
+  const vocabulary *from;
+  std::vector<token> from_ids;
+  bool is_frozen;
+  std::vector<std::size_t> index_first;
+  std::vector<state> index_states;
+  bool sentence_breaks;
+  bool at_start;
+  std::vector<std::uint32_t> start_counts;
+  std::vector<state> start_states;
+  std::uint64_t start_total;
+  std::vector<double> start_prob;
+  std::vector<std::uint32_t> start_alias;
+  std::unordered_map<state, std::vector<std::uint32_t> > suffix_slots;
+  std::unordered_map<state, std::size_t> sums_at;
+  std::vector<std::uint64_t> sums;
+  std::unordered_map<state, std::size_t> alias_at;
+  std::vector<double> alias_prob;
+  std::vector<std::uint32_t> alias_of;
+  state intern(const token *pref);
+  void push(token t);
+  std::size_t record(state st, token t, std::uint32_t n);
+  std::size_t position(state s, token t) const;
+  bool readStart(std::string_view line);
+  void buildIndex();
+  void buildStarts();
+  void buildDraws();
+  template <class Draw>
+  state pickState(Draw& draw) const;
+  template <class Draw>
+  state pickStart(Draw& draw) const;
+  template <class Draw>
+  std::size_t pickSuccessor(state st, Draw& draw) const;
+  template <class Draw>
+  std::size_t walk(token *out, std::size_t nwords, const token *pref,
+                   bool tryhard, Draw& draw) const;
+};
+
+}
+
+#endif // MARKOV_MODEL_HH_INCL
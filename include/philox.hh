@@ -0,0 +1,155 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MARKOV_PHILOX_HH_INCL
+#define MARKOV_PHILOX_HH_INCL
+
+#include <cstddef>
+#include <cstdint>
+
+namespace markov {
+
+/*!
+ * \brief A counter-based random number generator, Philox4x32-10.
+ *
+ * Each block of four 32-bit numbers is a fixed function of a key and
+ * a counter, so a generator keeps no state beyond where it is.  The
+ * key is a seed, and the upper half of the counter is a stream number,
+ * so every (seed, stream) pair names its own sequence, independent of
+ * the others and the same on every run.  Give each job of a parallel
+ * run its own stream, numbered by job rather than by thread, and the
+ * output does not depend on how the jobs were scheduled.
+ *
+ * Numbers are made in batches of several blocks at a time by a loop
+ * written lane by lane, which the compiler can turn into vector
+ * instructions.
+ *
+ * A philox meets the requirements of a uniform random bit generator,
+ * so it can be passed to the standard distributions and algorithms.
+ *
+ * \see J. K. Salmon et al., "Parallel random numbers: as easy as
+ * 1, 2, 3", SC '11.
+ */
+class philox {
+
+public:
+
+  /*!
+   * \brief Define the type of the numbers returned.
+   */
+  typedef std::uint32_t result_type;
+
+  /*!
+   * \brief The constructor.
+   *
+   * \param key The seed.
+   * \param stream The stream number.
+   */
+  explicit philox(std::uint64_t key = 0, std::uint64_t stream = 0);
+
+  /*!
+   * \brief Start over at the beginning of a stream.
+   *
+   * \param key The seed.
+   * \param stream The stream number.
+   */
+  void seed(std::uint64_t key, std::uint64_t stream = 0);
+
+  /*!
+   * \brief Return the smallest number returned.
+   */
+  static constexpr result_type min() {
+    return 0;
+  }
+
+  /*!
+   * \brief Return the largest number returned.
+   */
+  static constexpr result_type max() {
+    return 0xffffffff;
+  }
+
+  /*!
+   * \brief Return the next 32-bit number.
+   */
+  result_type operator()() {
+    if (this->pos == buffered)
+      this->refill();
+    return this->buf[this->pos++];
+  }
+
+  /*!
+   * \brief Return the next 64-bit number, made of the next two 32-bit
+   * numbers.
+   */
+  std::uint64_t next64() {
+    std::uint64_t hi = (*this)();
+    return hi << 32 | (*this)();
+  }
+
+  /*!
+   * \brief Return a number less than n, which must not be zero.
+   *
+   * The number is the high half of a 64-bit random number times n, so
+   * the bias is at most n / 2^64.
+   */
+  std::uint64_t below(std::uint64_t n);
+
+  /*!
+   * \brief Return a double in [0, 1) with 53 random bits.
+   */
+  double uniform() {
+    return (this->next64() >> 11) * 0x1.0p-53;
+  }
+
+  /*!
+   * \brief Compute one block directly.
+   *
+   * \param ctr The four words of the counter.
+   * \param key The two words of the key.
+   * \param out Receives the four words of the block.
+   */
+  static void block(const std::uint32_t ctr[4], const std::uint32_t key[2],
+                    std::uint32_t out[4]);
+
+  /*!
+   * \brief Fill an array with the next numbers of the stream.
+   *
+   * This gives the same numbers as calling operator() n times, but
+   * whole blocks are written straight into out.
+   *
+   * \param out The array.
+   * \param n The number of numbers wanted.
+   */
+  void generate(std::uint32_t *out, std::size_t n);
+
+private:
+  static const unsigned lanes = 8;
+  static const unsigned buffered = 4 * lanes;
+  std::uint32_t k[2];
+  std::uint64_t counter;
+  std::uint64_t stream_id;
+  std::uint32_t buf[buffered];
+  unsigned pos;
+  void blocks(std::uint32_t *out, std::size_t n);
+  void refill();
+};
+
+}
+
+#endif // MARKOV_PHILOX_HH_INCL
@@ -0,0 +1,189 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MARKOV_PREDICT_HH_INCL
+#define MARKOV_PREDICT_HH_INCL
+
+#include <model.hh>
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace markov {
+
+/*!
+ * \brief A likely next word.
+ */
+struct prediction {
+
+  /*!
+   * \brief The word, a view into the model's vocabulary.
+   */
+  std::string_view word;
+
+  /*!
+   * \brief The id of the word.
+   */
+  token id;
+
+  /*!
+   * \brief The fraction of the times the prefix was followed by the
+   * word.
+   */
+  double probability;
+};
+
+/*!
+ * \brief Top-k next word queries with a cache of recent prefixes.
+ *
+ * Text typed by a user is split into words and the last
+ * prefixLength() of them looked up in the model.  The answers for the
+ * most recently asked prefixes are kept, so a prefix asked again is
+ * answered without splitting, hashing or copying anything.
+ *
+ * The model should be frozen, and must not change while the cache is
+ * in use.  A cache is not safe to share between threads; give each
+ * thread its own.
+ */
+class prediction_cache {
+
+public:
+
+  /*!
+   * \brief The constructor.
+   *
+   * \param mod The model to query.
+   * \param topk The number of predictions to return for a prefix.
+   * \param cap The number of prefixes to remember.
+   */
+  explicit prediction_cache(const model& mod, std::size_t topk = 10,
+                            std::size_t cap = 4096);
+
+  /*!
+   * \brief Return the most likely words to follow some text.
+   *
+   * \param text Text ending with at least prefixLength() words.
+   * \return The predictions, most likely first.  The result is empty
+   * if the text is too short or its last words were never followed by
+   * anything.  It remains valid until the next call.
+   */
+  const std::vector<prediction>& predict(std::string_view text);
+
+  /*!
+   * \brief Return the number of queries answered from the cache.
+   */
+  unsigned long long hits() const;
+
+  /*!
+   * \brief Return the number of queries that had to ask the model.
+   */
+  unsigned long long misses() const;
+
+private:
+  struct entry {
+    std::string key;
+    std::vector<prediction> result;
+  };
+  const model& m;
+  std::size_t k;
+  std::size_t capacity;
+  std::list<entry> recent;
+  std::unordered_map<std::string_view, std::list<entry>::iterator> index;
+  std::vector<model::successor> scratch;
+  unsigned long long nhits;
+  unsigned long long nmisses;
+  std::string_view lastWords(std::string_view text) const;
+  void compute(std::string_view words, std::vector<prediction>& out);
+};
+
+/*!
+ * \brief Completions for a partly typed word.
+ *
+ * The index keeps every word of the model's vocabulary sorted by its
+ * bytes, so the words starting with some characters are one range
+ * found by binary search, and a tree of range maximums over how often
+ * each word occurs, so the most frequent words of a range come out in
+ * order without looking at the rest.
+ * A query looks up the complete words before the partial one as a
+ * prefix, and offers the successors of that state that start with
+ * the typed characters, most frequent first.  If there are not
+ * enough of those, the most frequent words in the range fill the
+ * rest.
+ *
+ * The model should be frozen, so that the successors of a state can
+ * be scanned in order and the scan can stop early, and must not
+ * change while the index is in use.  Queries only read the index and
+ * may be made from many threads at once.
+ */
+class completion_index {
+
+public:
+
+  /*!
+   * \brief Build the index.
+   *
+   * \param mod The model to complete from.
+   */
+  explicit completion_index(const model& mod);
+
+  /*!
+   * \brief Return completions for the last, partly typed, word of some
+   * text.
+   *
+   * If the text ends in whitespace, the partial word is empty and
+   * every word matches.  The probability of a completion from the
+   * prefix state is its share of that state's successors; for one
+   * from the word range, it is the word's share of all words.
+   *
+   * \param text The text typed so far.
+   * \param k The number of completions wanted.
+   * \param out Cleared, then filled with up to k completions, best
+   * first.
+   */
+  void complete(std::string_view text, std::size_t k,
+                std::vector<prediction>& out) const;
+
+  /*!
+   * \brief Return the range of words starting with some characters.
+   *
+   * \param partial The characters.
+   * \return Indexes into sorted(), first and past the end.
+   */
+  std::pair<std::size_t, std::size_t> range(std::string_view partial) const;
+
+  /*!
+   * \brief Return the ids of all words, in byte order of the words.
+   */
+  const std::vector<token>& sorted() const;
+
+private:
+  const model& m;
+  std::vector<token> by_text;
+  std::vector<std::uint64_t> frequency;
+  std::uint64_t nwords;
+  std::vector<std::size_t> tree;
+  bool better(std::size_t a, std::size_t b) const;
+  std::size_t best(std::size_t lo, std::size_t hi) const;
+};
+
+}
+
+#endif // MARKOV_PREDICT_HH_INCL
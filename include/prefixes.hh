@@ -0,0 +1,114 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MARKOV_PREFIXES_HH_INCL
+#define MARKOV_PREFIXES_HH_INCL
+
+#include <vocabulary.hh>
+#include <cstdint>
+#include <vector>
+
+namespace markov {
+
+/*!
+ * \brief A hash table numbering fixed length prefixes of token ids.
+ *
+ * Each distinct prefix is a state, numbered from zero in the order
+ * the prefixes were first added, so that callers can keep whatever
+ * they need per state in plain arrays.  The prefixes themselves are
+ * stored back to back in one array.
+ *
+ * \see model
+ */
+class prefix_table {
+
+public:
+
+  /*!
+   * \brief Define a type for state numbers.
+   */
+  typedef std::uint32_t state;
+
+  /*!
+   * \brief A state number that never names a state.
+   */
+  static constexpr state no_state = 0xffffffff;
+
+  /*!
+   * \brief The constructor.
+   *
+   * \param len The number of ids in each prefix, at least one.
+   */
+  explicit prefix_table(std::size_t len = 2);
+
+  /*!
+   * \brief Look up the state for a prefix.
+   *
+   * \param pref prefixLength() token ids.
+   * \return The state, or no_state if the prefix has not been added.
+   */
+  state find(const token *pref) const;
+
+  /*!
+   * \brief Return the state for a prefix, adding it if it is new.
+   *
+   * A new prefix gets the state size() had before the call.
+   *
+   * \param pref prefixLength() token ids.
+   */
+  state intern(const token *pref);
+
+  /*!
+   * \brief Return the prefix of a state, prefixLength() token ids.
+   *
+   * \param s A state less than size().
+   */
+  const token *prefixOf(state s) const {
+    return &this->keys[static_cast<std::size_t>(s) * this->prefix_len];
+  }
+
+  /*!
+   * \brief Return the number of states.
+   */
+  std::size_t size() const {
+    return this->keys.size() / this->prefix_len;
+  }
+
+  /*!
+   * \brief Return the number of ids in each prefix.
+   */
+  std::size_t prefixLength() const {
+    return this->prefix_len;
+  }
+
+  /*!
+   * \brief Remove all prefixes.
+   */
+  void clear();
+
+private:
+  std::size_t prefix_len;
+  std::vector<token> keys;
+  std::vector<state> slots;
+  std::size_t probe(const token *pref) const;
+  void grow();
+};
+
+}
+
+#endif // MARKOV_PREFIXES_HH_INCL
@@ -0,0 +1,174 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MARKOV_SAMPLER_HH_INCL
+#define MARKOV_SAMPLER_HH_INCL
+
+#include <model.hh>
+#include <map>
+#include <vector>
+
+namespace markov {
+
+class endings;
+class word_set;
+
+/*!
+ * \brief Generate from a model with temperature and top-p sampling.
+ *
+ * The temperature reshapes each state's distribution: a word that
+ * followed a prefix c times is chosen with weight c^(1/temperature),
+ * so temperatures below one favour the common words and those above
+ * one flatten the distribution.  A temperature of zero always picks
+ * the most frequent word.  Top-p (nucleus) sampling then keeps only
+ * the most likely words whose probabilities add up to at least p,
+ * and chooses among those.
+ *
+ * The successors of every state are sorted once, most frequent first,
+ * and for each temperature used the running sums of their weights are
+ * computed once and kept.  A word is then chosen with two binary
+ * searches of one state's sums, one to find where the top-p cut falls
+ * and one to find the word.
+ *
+ * The model must not change while the sampler is in use; freeze it
+ * after training.  Setting the temperature is not thread safe, but
+ * any number of threads may generate at once between settings.
+ */
+class sampler {
+
+public:
+
+  /*!
+   * \brief The constructor.
+   *
+   * The temperature starts at one and top-p at one, which chooses
+   * words just as model::generate does.
+   *
+   * \param mod The model to generate from.
+   */
+  explicit sampler(const model& mod);
+
+  /*!
+   * \brief Set the temperature.
+   *
+   * The weights for a temperature are computed the first time it is
+   * set and kept until clear() is called.
+   *
+   * \param t The temperature; a negative value is taken as zero.
+   */
+  void setTemperature(double t);
+
+  /*!
+   * \brief Return the temperature.
+   */
+  double temperature() const;
+
+  /*!
+   * \brief Set the share of probability that top-p sampling keeps.
+   *
+   * \param p A value greater than zero and at most one; one keeps
+   * every word.
+   */
+  void setTopP(double p);
+
+  /*!
+   * \brief Return the share of probability that top-p sampling keeps.
+   */
+  double topP() const;
+
+  /*!
+   * \brief Drop the weights kept for every temperature but the
+   * current one.
+   */
+  void clear();
+
+  /*!
+   * \brief Choose a word to follow a state.
+   *
+   * \param s A state less than the model's size().
+   * \return The id of the word.
+   */
+  token next(model::state s) const;
+
+  /*!
+   * \brief Generate a run of token ids, as model::generate does.
+   *
+   * \param out An array with room for nwords ids, which receives the
+   * prefix followed by the generated words.
+   * \param nwords The number of ids to generate, counting the prefix.
+   * \param pref prefixLength() ids to start from, or NULL to start
+   * from model::randomStart().
+   * \param tryhard Whether to continue from model::randomStart() when
+   * the generated words reach a prefix never followed by anything.
+   * \return The number of ids stored.
+   */
+  std::size_t generate(token *out, std::size_t nwords,
+                       const token *pref = NULL, bool tryhard = false) const;
+
+  /*!
+   * \brief Generate a run of token ids that meets some constraints.
+   *
+   * Banned words are never chosen.  Given endings, the walk only
+   * moves to states from which a terminal word can still be reached
+   * in the words left, and stops after the first terminal word.
+   * Words are drawn as generate() draws them and redrawn if they are
+   * not allowed; after a few misses the allowed words of the state
+   * are weighed directly.  If no allowed word is inside the top-p
+   * cut, the choice is made from all the allowed words.
+   *
+   * With no prefix given, or one that is not a state, the walk starts
+   * from a state picked by model::randomStart() whose prefix is not
+   * banned and can reach an ending in time.  The walk stops early at
+   * a state none of whose words are allowed.
+   *
+   * \param out An array with room for nwords ids, which receives the
+   * prefix followed by the generated words.
+   * \param nwords The most ids to generate, counting the prefix.
+   * \param pref prefixLength() ids to start from, or NULL.
+   * \param banned The words not to generate, or NULL.
+   * \param ends The words that may end the run, or NULL.
+   * \param tryhard Whether to continue from such a random start when
+   * the generated words reach a prefix never followed by anything.
+   * \return The number of ids stored, or zero if no start was found.
+   * Given endings, the last id stored is terminal unless the start
+   * was too far from one or banned words blocked every way to one.
+   */
+  std::size_t generate(token *out, std::size_t nwords, const token *pref,
+                       const word_set *banned, const endings *ends = NULL,
+                       bool tryhard = false) const;
+
+private:
+  const model& m;
+  std::vector<std::size_t> offsets;
+  std::vector<token> order;
+  std::map<double, std::vector<double> > tables;
+  const std::vector<double> *sums;
+  double temp;
+  double top_p;
+  model::state start(std::size_t left, const word_set *banned,
+                     const endings *ends) const;
+  std::size_t cut(std::size_t lo, std::size_t hi) const;
+  bool allowed(token w, token *next, const word_set *banned,
+               const endings *ends, std::size_t left) const;
+  token choose(model::state s, token *next, const word_set *banned,
+               const endings *ends, std::size_t left) const;
+};
+
+}
+
+#endif // MARKOV_SAMPLER_HH_INCL
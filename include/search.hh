@@ -0,0 +1,114 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MARKOV_SEARCH_HH_INCL
+#define MARKOV_SEARCH_HH_INCL
+
+#include <model.hh>
+#include <vector>
+
+namespace markov {
+
+/*!
+ * \brief Find the most likely continuations of a prefix.
+ *
+ * A beam search keeps the width most likely partial sequences at each
+ * step, extends each by every successor of its state, and keeps the
+ * width most likely of those.  Since what can follow depends only on
+ * the state, two sequences that reach the same state are merged and
+ * only the more likely one kept.
+ *
+ * All working storage is allocated once, by the constructor, and the
+ * sequences are tracked as token ids with back pointers, so nothing is
+ * allocated or copied per step.  A beam_search only reads the model;
+ * use one per thread.  On a frozen model, the successors of a state
+ * are tried most frequent first and the rest are skipped once they
+ * can no longer make the beam.
+ */
+class beam_search {
+
+public:
+
+  /*!
+   * \brief The constructor.
+   *
+   * \param mod The model to search.
+   * \param beam The number of sequences to keep at each step.
+   * \param nwords The number of words to generate after the prefix.
+   */
+  beam_search(const model& mod, std::size_t beam, std::size_t nwords);
+
+  /*!
+   * \brief Find the most likely continuation of a prefix.
+   *
+   * If every sequence reaches a prefix that was never followed before
+   * nwords words, the best sequence from the last step that had any
+   * is returned.
+   *
+   * \param pref prefixLength() ids to start from.
+   * \param out An array with room for nwords ids, which receives the
+   * continuation, not including the prefix.
+   * \param logprob If not NULL, receives the natural log-probability
+   * of the continuation given the prefix, or -HUGE_VAL if pref is not
+   * a prefix in the model.
+   * \return The number of ids stored, which is zero if pref is not a
+   * prefix in the model.
+   */
+  std::size_t run(const token *pref, token *out, double *logprob = NULL);
+
+private:
+  struct hypothesis {
+    model::state st;
+    double score;
+    std::size_t parent;
+    token word;
+  };
+  const model& m;
+  std::size_t width;
+  std::size_t length;
+  std::vector<hypothesis> steps;
+  std::vector<std::size_t> counts;
+  std::vector<hypothesis> candidates;
+  std::vector<token> next;
+};
+
+/*!
+ * \brief Run a beam search from many prefixes in parallel.
+ *
+ * \param m The model to search.
+ * \param width The number of sequences kept at each step.
+ * \param length The number of words to generate after each prefix.
+ * \param seeds nseeds prefixes of prefixLength() ids, one after the
+ * other.
+ * \param nseeds The number of prefixes.
+ * \param out An array of nseeds * length ids; the continuation of
+ * prefix i starts at out[i * length].
+ * \param lengths An array of nseeds values that receives the length
+ * of each continuation.
+ * \param logprobs If not NULL, an array of nseeds values that
+ * receives the log-probability of each continuation.
+ * \param threads The number of threads to use, or 0 for one per CPU.
+ */
+void beamSearch(const model& m, std::size_t width, std::size_t length,
+                const token *seeds, std::size_t nseeds, token *out,
+                std::size_t *lengths, double *logprobs = NULL,
+                unsigned threads = 0);
+
+}
+
+#endif // MARKOV_SEARCH_HH_INCL
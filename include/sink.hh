@@ -0,0 +1,145 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MARKOV_SINK_HH_INCL
+#define MARKOV_SINK_HH_INCL
+
+#include <vocabulary.hh>
+#include <string_view>
+#include <vector>
+
+#include <sys/uio.h>
+
+namespace markov {
+
+/*!
+ * \brief Gathered output of generated text to a file descriptor.
+ *
+ * A sink collects the pieces of its output as a list of iovecs and
+ * hands them to writev in large batches.  Long words, 64 bytes and
+ * up by default, are not copied at all: the iovec points at the
+ * caller's bytes.  Shorter words and separators are copied into a
+ * staging buffer, since an iovec of a few bytes costs more to gather
+ * than the bytes cost to copy.
+ *
+ * The bytes of every word added must stay valid and unchanged until
+ * they have been written.  The words of a chain or of a vocabulary
+ * that is not being added to are fine.
+ *
+ * The descriptor may be non-blocking.  When it would block, flush
+ * writes what it can and keeps the rest queued, and adding does not
+ * try to write again until the next explicit flush, so a sink can
+ * serve as the output queue of a socket that is written when poll says
+ * it is ready.  pending tells how much is still queued.
+ *
+ * Errors are sticky: after a failed write nothing more is written and
+ * good returns false.
+ */
+class fd_sink {
+
+public:
+
+  /*!
+   * \brief The constructor.
+   *
+   * \param out The file descriptor to write to.  It is not closed by
+   * the sink.
+   * \param bufsize Flush whenever about this many bytes are waiting.
+   * \param refsize The length from which words are referenced rather
+   * than copied.
+   */
+  explicit fd_sink(int out, std::size_t bufsize = 1 << 20,
+                   std::size_t refsize = 64);
+
+  /*!
+   * \brief The destructor.  Flushes anything waiting.
+   */
+  ~fd_sink();
+
+  fd_sink(const fd_sink&) = delete;
+  fd_sink& operator=(const fd_sink&) = delete;
+
+  /*!
+   * \brief Add some bytes to the output.
+   *
+   * \param w The bytes to add.
+   */
+  void add(std::string_view w);
+
+  /*!
+   * \brief Add a single byte, such as a separator, to the output.
+   *
+   * \param c The byte to add.
+   */
+  void add(char c);
+
+  /*!
+   * \brief Add the words for a run of token ids, separated by sep.
+   *
+   * \param dict The vocabulary the ids come from.
+   * \param ids The ids, each less than dict.size().
+   * \param n The number of ids.
+   * \param sep The byte to put between words.
+   */
+  void add(const vocabulary& dict, const token *ids, std::size_t n,
+           char sep = ' ');
+
+  /*!
+   * \brief Write everything waiting.
+   *
+   * On a non-blocking descriptor that cannot take everything, what is
+   * left stays queued; see pending().
+   *
+   * \return True unless a write has failed.
+   */
+  bool flush();
+
+  /*!
+   * \brief Return the number of bytes added but not yet written.
+   */
+  std::size_t pending() const;
+
+  /*!
+   * \brief Check that no write has failed.
+   */
+  bool good() const;
+
+  /*!
+   * \brief Return the number of bytes written so far.
+   */
+  unsigned long long bytes() const;
+
+private:
+  int fd;
+  std::size_t buffer_size;
+  std::size_t reference_size;
+  std::vector<char> staging;
+  std::size_t staged;
+  std::size_t run;
+  std::size_t waiting;
+  std::vector<iovec> iov;
+  unsigned long long written;
+  bool failed;
+  bool blocked;
+  void endRun();
+  void makeRoom(std::size_t n);
+};
+
+}
+
+#endif // MARKOV_SINK_HH_INCL
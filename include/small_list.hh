@@ -0,0 +1,265 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MARKOV_SMALL_LIST_HH_INCL
+#define MARKOV_SMALL_LIST_HH_INCL
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace markov {
+
+/*!
+ * \brief A list that keeps its first few elements inside itself.
+ *
+ * Up to N elements are stored in the list object, with no allocation
+ * at all; past that they move to the heap, and the capacity doubles
+ * as it would for a std::vector.  The inline elements share their
+ * space with the heap pointer, so a small_list of two 8-byte elements
+ * is no bigger than an empty std::vector.
+ *
+ * Elements are copied as bytes, so T must be trivially copyable.
+ * Iterators are plain pointers and, as with a std::vector, are
+ * invalidated by a push_back() that grows the list.
+ */
+template <class T, std::uint32_t N>
+class small_list {
+
+  static_assert(std::is_trivially_copyable<T>::value,
+                "small_list elements must be trivially copyable");
+  static_assert(N > 0, "small_list must hold at least one element inline");
+
+public:
+
+  /*!
+   * \brief Define the type of the elements.
+   */
+  typedef T value_type;
+
+  /*!
+   * \brief Define the type of an iterator.
+   */
+  typedef T *iterator;
+
+  /*!
+   * \brief Define the type of an iterator to const elements.
+   */
+  typedef const T *const_iterator;
+
+  /*!
+   * \brief The number of elements kept inline.
+   */
+  static const std::uint32_t inline_capacity = N;
+
+  /*!
+   * \brief The constructor, for an empty list.
+   */
+  small_list() : n(0), cap(N), store() {
+  }
+
+  /*!
+   * \brief The copy constructor.
+   */
+  small_list(const small_list& other) : n(0), cap(N), store() {
+    this->assign(other.begin(), other.end());
+  }
+
+  /*!
+   * \brief The move constructor, which takes over other's storage.
+   */
+  small_list(small_list&& other) noexcept : n(other.n), cap(other.cap) {
+    std::memcpy(&this->store, &other.store, sizeof(this->store));
+    other.n = 0;
+    other.cap = N;
+  }
+
+  /*!
+   * \brief The destructor.
+   */
+  ~small_list() {
+    if (this->spilled())
+      delete[] this->store.heap;
+  }
+
+  /*!
+   * \brief The copy assignment operator.
+   */
+  small_list& operator=(const small_list& other) {
+    if (this != &other)
+      this->assign(other.begin(), other.end());
+    return *this;
+  }
+
+  /*!
+   * \brief The move assignment operator.
+   */
+  small_list& operator=(small_list&& other) noexcept {
+    if (this != &other) {
+      if (this->spilled())
+        delete[] this->store.heap;
+      this->n = other.n;
+      this->cap = other.cap;
+      std::memcpy(&this->store, &other.store, sizeof(this->store));
+      other.n = 0;
+      other.cap = N;
+    }
+    return *this;
+  }
+
+  /*!
+   * \brief Return the number of elements.
+   */
+  std::size_t size() const {
+    return this->n;
+  }
+
+  /*!
+   * \brief Return true if the list is empty.
+   */
+  bool empty() const {
+    return this->n == 0;
+  }
+
+  /*!
+   * \brief Return true if the elements have moved to the heap.
+   */
+  bool spilled() const {
+    return this->cap > N;
+  }
+
+  /*!
+   * \brief Return a pointer to the first element.
+   */
+  T *data() {
+    return this->spilled() ? this->store.heap : this->store.local;
+  }
+
+  /*!
+   * \brief Return a pointer to the first element.
+   */
+  const T *data() const {
+    return this->spilled() ? this->store.heap : this->store.local;
+  }
+
+  /*!
+   * \brief Return an iterator to the first element.
+   */
+  iterator begin() {
+    return this->data();
+  }
+
+  /*!
+   * \brief Return an iterator past the last element.
+   */
+  iterator end() {
+    return this->data() + this->n;
+  }
+
+  /*!
+   * \brief Return an iterator to the first element.
+   */
+  const_iterator begin() const {
+    return this->data();
+  }
+
+  /*!
+   * \brief Return an iterator past the last element.
+   */
+  const_iterator end() const {
+    return this->data() + this->n;
+  }
+
+  /*!
+   * \brief Return an element.
+   *
+   * \param i An index less than size().
+   */
+  T& operator[](std::size_t i) {
+    return this->data()[i];
+  }
+
+  /*!
+   * \brief Return an element.
+   *
+   * \param i An index less than size().
+   */
+  const T& operator[](std::size_t i) const {
+    return this->data()[i];
+  }
+
+  /*!
+   * \brief Append an element.
+   *
+   * \param x The element.
+   */
+  void push_back(const T& x) {
+    if (this->n == this->cap)
+      this->grow(2 * this->cap);
+    this->data()[this->n++] = x;
+  }
+
+  /*!
+   * \brief Replace the elements with a copy of a range.
+   *
+   * \param first The start of the range.
+   * \param last The end of the range.
+   */
+  void assign(const T *first, const T *last) {
+    std::uint32_t len = static_cast<std::uint32_t>(last - first);
+    this->n = 0;
+    if (len > this->cap)
+      this->grow(len);
+    if (len > 0)
+      std::memcpy(this->data(), first, len * sizeof(T));
+    this->n = len;
+  }
+
+  /*!
+   * \brief Remove every element and give back any heap storage.
+   */
+  void clear() {
+    if (this->spilled())
+      delete[] this->store.heap;
+    this->n = 0;
+    this->cap = N;
+  }
+
+private:
+  std::uint32_t n;
+  std::uint32_t cap;
+  union {
+    T local[N];
+    T *heap;
+  } store;
+
+  void grow(std::uint32_t want) {
+    T *bigger = new T[want];
+    if (this->n > 0)
+      std::memcpy(bigger, this->data(), this->n * sizeof(T));
+    if (this->spilled())
+      delete[] this->store.heap;
+    this->store.heap = bigger;
+    this->cap = want;
+  }
+};
+
+}
+
+#endif // MARKOV_SMALL_LIST_HH_INCL
@@ -0,0 +1,97 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MARKOV_SOURCE_HH_INCL
+#define MARKOV_SOURCE_HH_INCL
+
+#include <cstddef>
+
+namespace markov {
+
+/*!
+ * \brief A block of raw input text handed out by a source.
+ *
+ * A source may split its input into blocks anywhere, including in
+ * the middle of a word, but a block never holds text from more than
+ * one document.
+ */
+struct buffer {
+
+  /*!
+   * \brief The bytes of the block.
+   */
+  const char *data;
+
+  /*!
+   * \brief The number of bytes in the block.
+   */
+  std::size_t size;
+
+  /*!
+   * \brief The index of the document the block belongs to.
+   *
+   * For sources that read a list of files, this is the index of the
+   * file in that list.
+   */
+  std::size_t document;
+
+  /*!
+   * \brief True if this is the first block of its document.
+   */
+  bool first;
+
+  /*!
+   * \brief True if this is the last block of its document.
+   */
+  bool last;
+};
+
+/*!
+ * \brief Interface for block oriented input to chain training.
+ *
+ * A source hands out the text of one or more documents in order, a
+ * block at a time.  It lets training read input without going
+ * through std::istream, so that reading can be done ahead of time,
+ * on other threads, or by the kernel.
+ *
+ * \see chain::add(source&, bool)
+ */
+class source {
+
+public:
+
+  /*!
+   * \brief The destructor.
+   */
+  virtual ~source() {}
+
+  /*!
+   * \brief Get the next block of input.
+   *
+   * The block remains valid until the next call to this method or
+   * until the source is destroyed, whichever comes first.
+   *
+   * \param buf Filled in with the next block.
+   * \return True if a block was returned, false at the end of input.
+   */
+  virtual bool next(buffer& buf) = 0;
+};
+
+}
+
+#endif // MARKOV_SOURCE_HH_INCL
@@ -0,0 +1,238 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MARKOV_TOKENS_HH_INCL
+#define MARKOV_TOKENS_HH_INCL
+
+#include <vocabulary.hh>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace markov {
+
+class source;
+
+/*!
+ * \brief The id that separates documents in a token file.
+ */
+const token document_break = 0xfffffffe;
+
+/*!
+ * \brief Write a pre-tokenized corpus file.
+ *
+ * A token file holds a corpus that has already been split into words
+ * and mapped to token ids, so that it can be trained on again and
+ * again, at any prefix length, without handling strings.  The layout,
+ * in host byte order, is:
+ *
+ * \li A 64 byte header: the magic "MKVTOK01", then the token count,
+ * the word count, and the file offsets of the token ids, the word
+ * offset table and the word bytes, all as 64 bit integers, followed
+ * by padding.
+ *
+ * \li The token ids as 32 bit integers.  document_break separates
+ * documents.
+ *
+ * \li The word table: word count plus one 64 bit offsets into the word
+ * bytes, then the word bytes themselves.
+ *
+ * \see token_file
+ */
+class token_writer {
+
+public:
+
+  /*!
+   * \brief The constructor.
+   *
+   * \param path The name of the file to create.
+   */
+  explicit token_writer(const std::string& path);
+
+  /*!
+   * \brief The destructor.  Calls close if it has not been called.
+   */
+  ~token_writer();
+
+  token_writer(const token_writer&) = delete;
+  token_writer& operator=(const token_writer&) = delete;
+
+  /*!
+   * \brief Check that the file is open and no write has failed.
+   */
+  bool good() const;
+
+  /*!
+   * \brief Add a word to the current document.
+   *
+   * \param w The word to add.
+   */
+  void add(std::string_view w);
+
+  /*!
+   * \brief Add every document from a source.
+   *
+   * The text is split into words the same way chain::add does, and
+   * each document in the source becomes a document in the file.
+   *
+   * \param in The source to read.
+   */
+  void add(source& in);
+
+  /*!
+   * \brief End the current document.
+   *
+   * Nothing is written if the current document is empty.
+   */
+  void endDocument();
+
+  /*!
+   * \brief Write the word table and header and close the file.
+   *
+   * \return True if the whole file was written successfully.
+   */
+  bool close();
+
+  /*!
+   * \brief Return the number of tokens written, not counting document
+   * breaks.
+   */
+  unsigned long long tokens() const;
+
+  /*!
+   * \brief Return the words seen so far.
+   */
+  const vocabulary& words() const;
+
+private:
+  std::ofstream out;
+  vocabulary vocab;
+  std::vector<token> pending;
+  unsigned long long ntokens;
+  unsigned long long nwritten;
+  bool in_document;
+  bool closed;
+  void flush();
+};
+
+/*!
+ * \brief Read access to a token file through a memory map.
+ *
+ * \see token_writer
+ */
+class token_file {
+
+public:
+
+  /*!
+   * \brief The constructor.  Nothing is opened.
+   */
+  token_file();
+
+  /*!
+   * \brief Open a token file.
+   *
+   * \param path The name of the file to open.
+   * \see isOpen
+   */
+  explicit token_file(const std::string& path);
+
+  /*!
+   * \brief The destructor.
+   */
+  ~token_file();
+
+  token_file(const token_file&) = delete;
+  token_file& operator=(const token_file&) = delete;
+
+  /*!
+   * \brief Map a token file, closing any file already open.
+   *
+   * \param path The name of the file to open.
+   * \return True on success, false if the file cannot be mapped or
+   * is not a valid token file.
+   */
+  bool open(const std::string& path);
+
+  /*!
+   * \brief Unmap the file.
+   */
+  void close();
+
+  /*!
+   * \brief Check whether a file is mapped.
+   */
+  bool isOpen() const;
+
+  /*!
+   * \brief Return a pointer to the first token id.
+   */
+  const token *begin() const;
+
+  /*!
+   * \brief Return a pointer past the last token id.
+   */
+  const token *end() const;
+
+  /*!
+   * \brief Return the number of ids, including document breaks.
+   */
+  std::size_t size() const;
+
+  /*!
+   * \brief Return the number of words in the file's word table.
+   */
+  std::size_t words() const;
+
+  /*!
+   * \brief Return a word from the file's word table.
+   *
+   * \param t An id less than words().
+   */
+  std::string_view word(token t) const;
+
+  /*!
+   * \brief Build a vocabulary holding the file's word table, with
+   * the same ids.
+   */
+  vocabulary dictionary() const;
+
+  /*!
+   * \brief Check whether a file starts with the token file magic.
+   *
+   * Only regular files are read; anything else is not a token file.
+   *
+   * \param path The name of the file to check.
+   */
+  static bool check(const std::string& path);
+
+private:
+  void *map;
+  std::size_t map_size;
+  const token *ids;
+  std::size_t nids;
+  const std::uint64_t *offsets;
+  const char *text;
+  std::size_t nwords;
+};
+
+}
+
+#endif // MARKOV_TOKENS_HH_INCL
@@ -0,0 +1,163 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MARKOV_VOCABULARY_HH_INCL
+#define MARKOV_VOCABULARY_HH_INCL
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace markov {
+
+/*!
+ * \brief Define a type for token ids.
+ */
+typedef std::uint32_t token;
+
+/*!
+ * \brief A token id that never names a word.
+ */
+const token no_token = 0xffffffff;
+
+/*!
+ * \brief A table mapping words to dense token ids and back.
+ *
+ * Ids are handed out in order starting at zero, so they can be used
+ * to index arrays.  The bytes of all words are stored back to back in
+ * one buffer, with an offset table marking where each word starts.
+ */
+class vocabulary {
+
+public:
+
+  /*!
+   * \brief The constructor.
+   */
+  vocabulary();
+
+  /*!
+   * \brief Build a vocabulary from a packed word table.
+   *
+   * Word i is the bytes from starts[i] up to starts[i + 1] in chars,
+   * and keeps id i.  Duplicate words keep their first id.
+   *
+   * \param chars The concatenated bytes of the words.
+   * \param starts The start of each word in chars, plus a final entry
+   * holding the total length.
+   * \param count The number of words.
+   */
+  vocabulary(const char *chars, const std::uint64_t *starts,
+             std::size_t count);
+
+  /*!
+   * \brief Return the id of a word, adding it if it is new.
+   *
+   * \param w The word to look up.
+   * \return The id of w.
+   */
+  token intern(std::string_view w);
+
+  /*!
+   * \brief Return the id of a word without adding it.
+   *
+   * \param w The word to look up.
+   * \return The id of w, or no_token if it is not in the table.
+   */
+  token find(std::string_view w) const;
+
+  /*!
+   * \brief Return the word with the given id.
+   *
+   * The view remains valid until the next word is added.
+   *
+   * \param t An id less than size().
+   */
+  std::string_view word(token t) const {
+    return std::string_view(this->text.data() + this->offsets[t],
+                            this->offsets[t + 1] - this->offsets[t]);
+  }
+
+  /*!
+   * \brief Return the number of bytes join would need for a run of
+   * ids.
+   *
+   * \param ids The ids, each less than size().
+   * \param n The number of ids.
+   */
+  std::size_t joinedLength(const token *ids, std::size_t n) const;
+
+  /*!
+   * \brief Copy the words for a run of ids into a buffer, separated
+   * by sep.
+   *
+   * The words are copied straight out of the table; no stream or
+   * string is involved.  Nothing is written past size bytes: the
+   * copy stops before the first word that does not fit, and no
+   * terminating null is added.
+   *
+   * \param ids The ids, each less than size().
+   * \param n The number of ids.
+   * \param buf The buffer to write to.
+   * \param size The size of buf.
+   * \param sep The byte to put between words.
+   * \return The number of bytes written.
+   */
+  std::size_t join(const token *ids, std::size_t n, char *buf,
+                   std::size_t size, char sep = ' ') const;
+
+  /*!
+   * \brief Return the number of words in the table.
+   */
+  std::size_t size() const {
+    return this->offsets.size() - 1;
+  }
+
+  /*!
+   * \brief Return the concatenated bytes of all words.
+   */
+  const std::string& bytes() const {
+    return this->text;
+  }
+
+  /*!
+   * \brief Return the offset of each word in bytes(), followed by the
+   * total length.
+   */
+  const std::vector<std::uint64_t>& starts() const {
+    return this->offsets;
+  }
+
+  /*!
+   * \brief Remove all words.
+   */
+  void clear();
+
+private:
+  std::string text;
+  std::vector<std::uint64_t> offsets;
+  std::vector<token> slots;
+  std::size_t probe(std::string_view w) const;
+  void grow();
+};
+
+}
+
+#endif // MARKOV_VOCABULARY_HH_INCL
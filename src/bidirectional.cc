@@ -0,0 +1,161 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <config.h>
+#include <bidirectional.hh>
+#include <chain.hh>
+#include <tokens.hh>
+#include "words.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <numeric>
+
+namespace markov {
+
+bidirectional::bidirectional(std::size_t len) : fwd(len), bwd(len),
+                                                reversed(fwd.prefixLength()) {
+}
+
+// Before the forward model takes t, its window holds the words before
+// t; read backwards from t they are the backward model's prefix, and
+// the first of them follows it.
+void bidirectional::push(token t) {
+  const std::vector<token>& win = this->fwd.window;
+  std::size_t len = this->fwd.prefix_len;
+  if (win.size() == len) {
+    this->reversed[0] = t;
+    std::reverse_copy(win.begin() + 1, win.end(), this->reversed.begin() + 1);
+    this->bwd.record(this->bwd.intern(this->reversed.data()), win[0], 1);
+  }
+  this->fwd.push(t);
+}
+
+void bidirectional::add(std::string_view w) {
+  this->push(this->fwd.vocab.intern(w));
+}
+
+void bidirectional::add(const token *ids, std::size_t n) {
+  std::size_t nwords = this->fwd.vocab.size();
+  for (std::size_t i = 0; i < n; i++) {
+    if (ids[i] < nwords)
+      this->push(ids[i]);
+    else if (ids[i] == document_break)
+      this->reset();
+  }
+}
+
+void bidirectional::add(source& in, bool resetprefix) {
+  splitWords(in,
+             [this](std::string_view w) { this->add(w); },
+             [this, resetprefix](std::size_t) {
+               if (resetprefix)
+                 this->reset();
+             });
+}
+
+void bidirectional::reset() {
+  this->fwd.reset();
+}
+
+void bidirectional::freeze() {
+  this->bwd.vocab = this->fwd.vocab;
+  this->fwd.freeze();
+  this->bwd.freeze();
+
+  // Group the backward states by the first word of their prefix, so
+  // that a seed's states are a slice of one array.
+  std::size_t nwords = this->fwd.vocab.size();
+  this->seed_at.assign(nwords + 1, 0);
+  for (model::state st = 0; st < this->bwd.size(); st++)
+    this->seed_at[this->bwd.prefixOf(st)[0] + 1]++;
+  std::partial_sum(this->seed_at.begin(), this->seed_at.end(),
+                   this->seed_at.begin());
+  std::vector<std::size_t> fill(this->seed_at.begin(),
+                                this->seed_at.end() - 1);
+  this->seeds.resize(this->bwd.size());
+  for (model::state st = 0; st < this->bwd.size(); st++)
+    this->seeds[fill[this->bwd.prefixOf(st)[0]]++] = st;
+}
+
+const model& bidirectional::forward() const {
+  return this->fwd;
+}
+
+const model& bidirectional::backward() const {
+  return this->bwd;
+}
+
+const vocabulary& bidirectional::words() const {
+  return this->fwd.vocab;
+}
+
+// A random backward state whose prefix starts with seed.
+model::state bidirectional::seedState(token seed) const {
+  if (this->seed_at.empty() || seed >= this->seed_at.size() - 1)
+    return model::no_state;
+  std::size_t lo = this->seed_at[seed];
+  std::size_t n = this->seed_at[seed + 1] - lo;
+  return n ? this->seeds[lo + random() % n] : model::no_state;
+}
+
+bool bidirectional::generate(token seed, std::size_t before,
+                             std::size_t after, std::vector<token>& out,
+                             std::size_t *at) const {
+  out.clear();
+  if (!chain::isSeeded())
+    chain::seed();
+  model::state st = this->seedState(seed);
+  if (st == model::no_state)
+    return false;
+  std::size_t len = this->fwd.prefix_len;
+
+  // The backward walk gives the seed and the words before it, last
+  // first.
+  std::vector<token> back;
+  this->bwd.generate(back, before + 1, this->bwd.prefixOf(st));
+  out.assign(back.rbegin(), back.rend());
+  std::size_t pos = out.size() - 1;
+  if (at)
+    *at = pos;
+
+  // The forward walk starts from the same words read forwards, and
+  // only the words after the seed are kept.
+  std::vector<token> pref(this->bwd.prefixOf(st),
+                          this->bwd.prefixOf(st) + len);
+  std::reverse(pref.begin(), pref.end());
+  if (after > 0 && this->fwd.find(pref.data()) != model::no_state) {
+    std::vector<token> ahead;
+    this->fwd.generate(ahead, len + after, pref.data());
+    out.insert(out.end(), ahead.begin() + len, ahead.end());
+  }
+  return true;
+}
+
+bool bidirectional::generate(std::string_view seed, std::size_t before,
+                             std::size_t after, std::vector<token>& out,
+                             std::size_t *at) const {
+  token t = this->fwd.vocab.find(seed);
+  if (t == no_token) {
+    out.clear();
+    return false;
+  }
+  return this->generate(t, before, after, out, at);
+}
+
+}
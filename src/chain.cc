@@ -18,29 +18,65 @@
  */
 #include <config.h>
 #include <chain.hh>
+#include <sink.hh>
+#include <source.hh>
+#include <philox.hh>
+#include "words.hh"
+#include <cerrno>
 #include <cstdlib>
+#include <ctime>
+#include <iterator>
 
+#ifdef HAVE_SYS_RANDOM_H
+#include <sys/random.h>
+#endif
 #ifdef HAVE_RANDOM_DEVICE
-#include <fstream>
-#else
-#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 
 namespace markov {
 
 bool chain::is_seeded = false;
 
-static std::size_t getSeed(void)
-{
-  std::size_t seed = 0;
+namespace {
+
 #ifdef HAVE_RANDOM_DEVICE
-  std::ifstream in(RANDOM_DEVICE, std::ios::in);
-  in.read((char *)&seed, sizeof(seed));
-  in.close();
-#else
-  (void)std::time((std::time_t *)&seed);
+// Read exactly len bytes from fd, retrying on short reads.
+bool readAll(int fd, char *buf, std::size_t len)
+{
+  while (len > 0) {
+    ssize_t n = ::read(fd, buf, len);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    buf += n;
+    len -= n;
+  }
+  return true;
+}
 #endif
-  return seed;
+
+// Draws from the class wide generator, as the chain always has.
+struct shared_draw {
+  shared_draw() {
+    if (!chain::isSeeded())
+      chain::seed();
+  }
+  std::size_t operator()(std::size_t n) {
+    return random() % n;
+  }
+};
+
+// Draws from one stream of a counter-based generator.
+struct stream_draw {
+  philox& rng;
+  std::size_t operator()(std::size_t n) {
+    return static_cast<std::size_t>(this->rng.below(n));
+  }
+};
+
 }
 
 void chain::add(const std::string& s) {
@@ -51,6 +87,14 @@ void chain::add(const std::string& s) {
   this->current_prefix.push_back(s);
 }
 
+void chain::add(std::string&& s) {
+  if (this->current_prefix.size() == this->prefix_len) {
+    (*this)[this->current_prefix].push_back(s);
+    this->current_prefix.pop_front();
+  }
+  this->current_prefix.push_back(std::move(s));
+}
+
 void chain::add(std::istream& in, bool resetprefix) {
   std::string buf;
   if (resetprefix)
@@ -59,44 +103,130 @@ void chain::add(std::istream& in, bool resetprefix) {
     this->add(buf);
 }
 
-void chain::generate(std::ostream& s, std::size_t nwords, prefix pref,
-  bool tryhard) {
-  if (this->isValidPrefix(pref))
-    this->current_prefix = pref;
-  else
-    this->current_prefix = this->randomPrefix();
+void chain::add(source& in, bool resetprefix) {
+  splitWords(in,
+             [this](std::string_view w) { this->add(std::string(w)); },
+             [this, resetprefix](std::size_t) {
+               if (resetprefix)
+                 this->current_prefix.clear();
+             });
+}
+
+void chain::reset() {
+  this->current_prefix.clear();
+}
+
+bool chain::merge(const chain& other) {
+  if (other.prefix_len != this->prefix_len)
+    return false;
+  for (const_iterator it = other.begin(); it != other.end(); it++) {
+    std::vector<std::string>& suf = (*this)[it->first];
+    suf.insert(suf.end(), it->second.begin(), it->second.end());
+  }
+  return true;
+}
+
+bool chain::merge(chain&& other) {
+  if (other.prefix_len != this->prefix_len)
+    return false;
+  if (this->empty()) {
+    this->swap(other);
+    other.current_prefix.clear();
+    return true;
+  }
+  for (iterator it = other.begin(); it != other.end(); it++) {
+    std::vector<std::string>& suf = (*this)[it->first];
+    if (suf.empty())
+      suf.swap(it->second);
+    else
+      suf.insert(suf.end(), std::make_move_iterator(it->second.begin()),
+                 std::make_move_iterator(it->second.end()));
+  }
+  other.clear();
+  other.current_prefix.clear();
+  return true;
+}
 
-  if (!chain::is_seeded)
-    chain::seed();
+// The walk behind both generate methods.  Every word is passed to
+// emit as a reference into the chain itself, which stays valid for as
+// long as the chain is not changed.
+template <class Emit, class Draw>
+void chain::walk(std::size_t nwords, const prefix& pref, bool tryhard,
+                 Emit emit, Draw& draw) {
+  iterator it = this->find(pref);
+  if (it == this->end()) {
+    this->current_prefix = this->pickPrefix(draw);
+    it = this->find(this->current_prefix);
+  }
+  else
+    this->current_prefix = pref;
 
   std::size_t i;
   for (i = 0; i < this->prefix_len; i++)
-    s << this->current_prefix.at(i) << ' ';
+    emit(it->first.at(i));
 
   for (; i < nwords; i++) {
-    std::vector<std::string>& suf = (*this)[current_prefix];
-    const std::string& w = suf[random() % suf.size()];
-    s << w << ' ';
+    const std::vector<std::string>& suf = it->second;
+    const std::string& w = suf.size() == 1 ? suf[0] : suf[draw(suf.size())];
+    emit(w);
+    std::string front = std::move(this->current_prefix.front());
+    this->current_prefix.pop_front();
+    this->current_prefix.push_back(w);
     // To avoid a SIGFPE when we get the last entry from the original
     // input:
-    pref = this->current_prefix;
-    pref.pop_front();
-    pref.push_back(w);
-    if (this->isValidPrefix(pref))
-      this->current_prefix = pref;
-    else {
+    it = this->find(this->current_prefix);
+    if (it == this->end()) {
       if (tryhard) {
-        pref = this->randomPrefix();
-        this->current_prefix = pref;
+        this->current_prefix = this->pickPrefix(draw);
+        it = this->find(this->current_prefix);
       }
-      else
+      else {
+        this->current_prefix.pop_back();
+        this->current_prefix.push_front(std::move(front));
         break;
+      }
     }
   }
+}
+
+void chain::generate(std::ostream& s, std::size_t nwords, prefix pref,
+  bool tryhard) {
+  shared_draw draw;
+  this->walk(nwords, pref, tryhard,
+             [&s](const std::string& w) { s << w << ' '; }, draw);
+  s << std::endl;
+}
+
+void chain::generate(fd_sink& s, std::size_t nwords, const prefix& pref,
+  bool tryhard) {
+  shared_draw draw;
+  this->walk(nwords, pref, tryhard,
+             [&s](const std::string& w) {
+               s.add(w);
+               s.add(' ');
+             }, draw);
+  s.add('\n');
+}
 
+void chain::generate(std::ostream& s, std::size_t nwords, const prefix& pref,
+  bool tryhard, philox& rng) {
+  stream_draw draw{rng};
+  this->walk(nwords, pref, tryhard,
+             [&s](const std::string& w) { s << w << ' '; }, draw);
   s << std::endl;
 }
 
+void chain::generate(fd_sink& s, std::size_t nwords, const prefix& pref,
+  bool tryhard, philox& rng) {
+  stream_draw draw{rng};
+  this->walk(nwords, pref, tryhard,
+             [&s](const std::string& w) {
+               s.add(w);
+               s.add(' ');
+             }, draw);
+  s.add('\n');
+}
+
 void chain::generate(std::ostream& s, std::size_t nwords, bool tryhard) {
   prefix start = this->randomPrefix();
   this->generate(s, nwords, start, tryhard);
@@ -180,13 +310,11 @@ chain::prefix chain::currentPrefix(prefix pref) {
   return this->current_prefix;
 }
 
-chain::prefix chain::randomPrefix() {
+template <class Draw>
+chain::prefix chain::pickPrefix(Draw& draw) {
   prefix pref;
 
-  if (!chain::is_seeded)
-    chain::seed();
-
-  std::size_t i = random() % this->size();
+  std::size_t i = draw(this->size());
   std::size_t j = 0;
   for (const_iterator it = this->begin(); it != this->end() && j <= i;
        it++, j++)
@@ -195,6 +323,16 @@ chain::prefix chain::randomPrefix() {
   return pref;
 }
 
+chain::prefix chain::randomPrefix() {
+  shared_draw draw;
+  return this->pickPrefix(draw);
+}
+
+chain::prefix chain::randomPrefix(philox& rng) {
+  stream_draw draw{rng};
+  return this->pickPrefix(draw);
+}
+
 bool chain::isValidPrefix(prefix pref) {
   bool isValid = true;
   iterator it = this->find(pref);
@@ -221,9 +359,35 @@ bool chain::isSeeded() {
 
 void chain::seed(bool force) {
   if (force || !chain::is_seeded) {
-    srandom(getSeed());
+    srandom(static_cast<unsigned int>(chain::entropy()));
     chain::is_seeded = true;
   }
 }
 
+void chain::setSeed(unsigned int value) {
+  srandom(value);
+  chain::is_seeded = true;
+}
+
+// getrandom() needs no file at all.  Failing that, the random device
+// is opened the first time and kept open, so a caller that reseeds for
+// every request pays for one read rather than an open and a close.
+std::uint64_t chain::entropy() {
+  std::uint64_t value = 0;
+#if defined(HAVE_GETRANDOM) && defined(HAVE_SYS_RANDOM_H)
+  ssize_t n;
+  while ((n = getrandom(&value, sizeof(value), 0)) < 0 && errno == EINTR)
+    ;
+  if (n == static_cast<ssize_t>(sizeof(value)))
+    return value;
+#endif
+#ifdef HAVE_RANDOM_DEVICE
+  static int fd = ::open(RANDOM_DEVICE, O_RDONLY | O_CLOEXEC);
+  if (fd >= 0 && readAll(fd, reinterpret_cast<char *>(&value), sizeof(value)))
+    return value;
+#endif
+  value = static_cast<std::uint64_t>(std::time(NULL));
+  return value ^ static_cast<std::uint64_t>(std::clock()) << 32;
+}
+
 }
@@ -0,0 +1,241 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <config.h>
+#include <classify.hh>
+#include "words.hh"
+
+#include <algorithm>
+#include <cmath>
+
+namespace markov {
+
+// The running product of each class's probabilities.  Products are
+// kept as a mantissa and a power of two, renormalized every few
+// tokens, so that only one log per class is taken per document.  A
+// factor is at least the class's unigram share, 1 / (tokens + words),
+// times 1 / (total + 1) for a smoothed transition, which is above
+// 2^-64 for counts that fit in 32 bits, so 8 of them cannot underflow
+// a double.
+class classifier::accumulator {
+public:
+  accumulator(const classifier& c) :
+    prod(c.nclasses, 1.0), exp2(c.nclasses, 0), inv(c.nclasses),
+    zeros(c.nclasses, 0), steps(0) {
+    for (std::size_t k = 0; k < c.nclasses; k++)
+      this->inv[k] = 1.0 / (c.ntokens[k] + c.words().size());
+  }
+
+  void step() {
+    if (++this->steps % 8 == 0)
+      this->normalize();
+  }
+
+  void normalize() {
+    for (std::size_t k = 0; k < this->prod.size(); k++) {
+      int e;
+      this->prod[k] = std::frexp(this->prod[k], &e);
+      this->exp2[k] += e;
+    }
+  }
+
+  void result(double *scores) {
+    for (std::size_t k = 0; k < this->prod.size(); k++)
+      scores[k] = std::log(this->prod[k]) + this->exp2[k] * M_LN2;
+  }
+
+  std::vector<double> prod;
+  std::vector<long> exp2;
+  std::vector<double> inv;
+  std::vector<std::uint32_t> zeros;
+  unsigned long steps;
+};
+
+classifier::classifier(const std::vector<std::string>& labels,
+                       std::size_t len) :
+  names(labels), nclasses(labels.size()), prefix_len(len ? len : 1),
+  chains(prefix_len), ntokens(labels.size(), 0) {
+  this->window.reserve(this->prefix_len);
+}
+
+std::size_t classifier::classes() const {
+  return this->nclasses;
+}
+
+const std::string& classifier::label(std::size_t c) const {
+  return this->names[c];
+}
+
+std::size_t classifier::prefixLength() const {
+  return this->prefix_len;
+}
+
+const vocabulary& classifier::words() const {
+  return this->chains.vocab;
+}
+
+// The shared model holds every class's transitions, and the position
+// of a successor in it indexes that successor's per-class counts.
+void classifier::addToken(std::size_t c, token t) {
+  std::size_t n = this->nclasses;
+  if (this->unigrams.size() < (t + 1) * n)
+    this->unigrams.resize(this->chains.vocab.size() * n, 0);
+  this->unigrams[t * n + c]++;
+  this->ntokens[c]++;
+
+  if (this->window.size() == this->prefix_len) {
+    model::state st = this->chains.intern(this->window.data());
+    if (st == this->counts.size()) {
+      this->counts.push_back(std::vector<std::uint32_t>());
+      this->totals.resize(this->totals.size() + n, 0);
+      this->distinct.resize(this->distinct.size() + n, 0);
+    }
+    std::size_t j = this->chains.record(st, t, 1);
+    if (this->counts[st].size() < (j + 1) * n)
+      this->counts[st].resize((j + 1) * n, 0);
+    std::uint32_t& cnt = this->counts[st][j * n + c];
+    if (cnt++ == 0)
+      this->distinct[st * n + c]++;
+    this->totals[st * n + c]++;
+    std::copy(this->window.begin() + 1, this->window.end(),
+              this->window.begin());
+    this->window.back() = t;
+  }
+  else
+    this->window.push_back(t);
+}
+
+void classifier::add(std::size_t c, std::string_view w) {
+  this->addToken(c, this->chains.vocab.intern(w));
+}
+
+void classifier::add(std::size_t c, source& in) {
+  splitWords(in,
+             [this, c](std::string_view w) { this->add(c, w); },
+             [this](std::size_t) { this->reset(); });
+}
+
+void classifier::reset() {
+  this->window.clear();
+}
+
+// Multiply every class's probability of t after the last wlen ids of
+// win into the accumulator.
+void classifier::scoreToken(const token *win, std::size_t wlen, token t,
+                            accumulator& acc) const {
+  std::size_t n = this->nclasses;
+  const std::uint32_t *uni = &this->unigrams[t * n];
+  double *prod = acc.prod.data();
+  const double *inv = acc.inv.data();
+
+  model::state st = wlen == this->prefix_len
+    ? this->chains.find(win) : model::no_state;
+  if (st == model::no_state) {
+    for (std::size_t k = 0; k < n; k++)
+      prod[k] *= (uni[k] + 1.0) * inv[k];
+  }
+  else {
+    std::size_t j = this->chains.position(st, t);
+    const std::uint32_t *cnt = j < this->chains.successors(st).size()
+      ? &this->counts[st][j * n] : acc.zeros.data();
+    const std::uint32_t *tot = &this->totals[st * n];
+    const std::uint32_t *dis = &this->distinct[st * n];
+    for (std::size_t k = 0; k < n; k++) {
+      double pu = (uni[k] + 1.0) * inv[k];
+      double den = static_cast<double>(tot[k]) + dis[k];
+      double p = (cnt[k] + dis[k] * pu) / (den > 0 ? den : 1.0);
+      prod[k] *= den > 0 ? p : pu;
+    }
+  }
+  acc.step();
+}
+
+void classifier::score(const token *ids, std::size_t n,
+                       double *scores) const {
+  accumulator acc(*this);
+  std::size_t nwords = this->chains.vocab.size();
+  // wlen counts how many of the ids before i belong to the current
+  // prefix; an unknown id starts it over.
+  std::size_t wlen = 0;
+  for (std::size_t i = 0; i < n; i++) {
+    if (ids[i] >= nwords) {
+      wlen = 0;
+      continue;
+    }
+    this->scoreToken(ids + i - wlen, wlen, ids[i], acc);
+    if (wlen < this->prefix_len)
+      wlen++;
+  }
+  acc.result(scores);
+}
+
+std::size_t classifier::score(source& in, std::vector<double>& scores,
+                              std::vector<std::size_t> *scored) const {
+  std::size_t n = this->nclasses;
+  std::vector<token> hist;
+  hist.reserve(this->prefix_len);
+  std::size_t doc = 0;
+  std::size_t words = 0;
+  bool started = false;
+  accumulator acc(*this);
+  scores.clear();
+  if (scored)
+    scored->clear();
+
+  auto finish = [&]() {
+    if (!started)
+      return;
+    if (scores.size() < (doc + 1) * n)
+      scores.resize((doc + 1) * n, 0);
+    acc.result(&scores[doc * n]);
+    if (scored) {
+      if (scored->size() < doc + 1)
+        scored->resize(doc + 1, 0);
+      (*scored)[doc] = words;
+    }
+  };
+  splitWords(in,
+             [&](std::string_view w) {
+               token t = this->chains.vocab.find(w);
+               if (t == no_token) {
+                 hist.clear();
+                 return;
+               }
+               this->scoreToken(hist.data(), hist.size(), t, acc);
+               words++;
+               if (hist.size() == this->prefix_len)
+                 hist.erase(hist.begin());
+               hist.push_back(t);
+             },
+             [&](std::size_t d) {
+               finish();
+               doc = d;
+               words = 0;
+               started = true;
+               hist.clear();
+               acc = accumulator(*this);
+             });
+  finish();
+  return started ? doc + 1 : 0;
+}
+
+std::size_t classifier::best(const double *scores) const {
+  return std::max_element(scores, scores + this->nclasses) - scores;
+}
+
+}
@@ -0,0 +1,340 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <config.h>
+#include <compress.hh>
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace markov {
+
+// Read until at least min bytes are in hand, the buffer is full or
+// the input ends.  Returns the byte count, or -1 on error.
+static ssize_t readAtLeast(int fd, char *p, std::size_t n, std::size_t min)
+{
+  std::size_t got = 0;
+  while (got < n && got < min) {
+    ssize_t r = ::read(fd, p + got, n - got);
+    if (r < 0 && errno == EINTR)
+      continue;
+    if (r < 0)
+      return -1;
+    if (r == 0)
+      break;
+    got += r;
+  }
+  return got;
+}
+
+compressed_reader::compressed_reader(const std::vector<std::string>& files,
+                                     std::size_t block_size,
+                                     unsigned nblocks) :
+  files(files), block_size(block_size ? block_size : 1 << 18),
+  ring(nblocks > 1 ? nblocks : 2), produce_pos(0), consume_pos(0), full(0),
+  holding(false), done(false), stopping(false), nbytes(0) {
+  for (std::size_t i = 0; i < this->ring.size(); i++)
+    this->ring[i].data = new char[this->block_size];
+  this->producer = std::thread(&compressed_reader::produce, this);
+}
+
+compressed_reader::~compressed_reader() {
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stopping = true;
+  }
+  this->not_full.notify_all();
+  this->producer.join();
+  for (std::size_t i = 0; i < this->ring.size(); i++)
+    delete[] this->ring[i].data;
+}
+
+bool compressed_reader::next(buffer& buf) {
+  std::unique_lock<std::mutex> lock(this->mutex);
+  if (this->holding) {
+    this->consume_pos = (this->consume_pos + 1) % this->ring.size();
+    this->full--;
+    this->holding = false;
+    this->not_full.notify_one();
+  }
+  this->not_empty.wait(lock, [this] { return this->full > 0 || this->done; });
+  if (this->full == 0)
+    return false;
+
+  const block& b = this->ring[this->consume_pos];
+  buf.data = b.data;
+  buf.size = b.size;
+  buf.document = b.document;
+  buf.first = b.first;
+  buf.last = b.last;
+  this->nbytes += b.size;
+  this->holding = true;
+  return true;
+}
+
+unsigned long long compressed_reader::bytes() const {
+  return this->nbytes;
+}
+
+const std::vector<std::string>& compressed_reader::errors() const {
+  return this->failed;
+}
+
+bool compressed_reader::supports(format f) {
+  switch (f) {
+  case plain:
+    return true;
+  case gzip:
+#ifdef HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+  case zstd:
+#ifdef HAVE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+  }
+  return false;
+}
+
+compressed_reader::format compressed_reader::detect(const char *data,
+                                                    std::size_t size) {
+  const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+  if (size >= 2 && p[0] == 0x1f && p[1] == 0x8b)
+    return gzip;
+  if (size >= 4 && p[0] == 0x28 && p[1] == 0xb5 && p[2] == 0x2f
+      && p[3] == 0xfd)
+    return zstd;
+  return plain;
+}
+
+bool compressed_reader::compressedName(const std::string& name) {
+  static const char *const exts[] = { ".gz", ".z", ".zst", ".zstd" };
+  for (std::size_t i = 0; i < sizeof(exts) / sizeof(exts[0]); i++) {
+    std::size_t n = std::strlen(exts[i]);
+    if (name.size() > n && name.compare(name.size() - n, n, exts[i]) == 0)
+      return true;
+  }
+  return false;
+}
+
+void compressed_reader::produce() {
+  for (std::size_t f = 0; f < this->files.size(); f++) {
+    bool ok = this->decodeFile(f);
+    std::lock_guard<std::mutex> lock(this->mutex);
+    if (!ok)
+      this->failed.push_back(this->files[f]);
+    if (this->stopping)
+      break;
+  }
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->done = true;
+  this->not_empty.notify_all();
+}
+
+// Wait for a free block in the ring and claim it for the producer.
+// Returns NULL if the reader is being destroyed.
+compressed_reader::block *compressed_reader::acquire(std::size_t f,
+                                                     bool first) {
+  std::unique_lock<std::mutex> lock(this->mutex);
+  this->not_full.wait(lock, [this] {
+    return this->stopping || this->full < this->ring.size();
+  });
+  if (this->stopping)
+    return NULL;
+  block *b = &this->ring[this->produce_pos];
+  b->size = 0;
+  b->document = f;
+  b->first = first;
+  b->last = false;
+  return b;
+}
+
+// Hand the block being filled over to the consumer.
+void compressed_reader::publish(bool last) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->ring[this->produce_pos].last = last;
+  this->produce_pos = (this->produce_pos + 1) % this->ring.size();
+  this->full++;
+  this->not_empty.notify_one();
+}
+
+// Decode one file into the ring.  The first read goes straight into
+// the first block, so plain text is never copied; compressed input
+// is moved to a separate buffer and decoded into the blocks.  The
+// file's last block is always published, even after an error.
+bool compressed_reader::decodeFile(std::size_t f) {
+  const std::string& name = this->files[f];
+  bool is_stdin = name == "-";
+  int fd = is_stdin ? STDIN_FILENO
+                    : ::open(name.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+
+  bool ok = true;
+  block *b = this->acquire(f, true);
+  if (b == NULL) {
+    if (!is_stdin)
+      ::close(fd);
+    return true;
+  }
+
+  ssize_t n = readAtLeast(fd, b->data, this->block_size, 4);
+  format fmt = n > 0 ? detect(b->data, n) : plain;
+  if (n < 0)
+    ok = false;
+  else if (!supports(fmt))
+    ok = false;
+  else if (fmt == plain) {
+    b->size = n;
+    while (b != NULL) {
+      if (b->size == this->block_size) {
+        this->publish(false);
+        b = this->acquire(f, false);
+        continue;
+      }
+      ssize_t r = ::read(fd, b->data + b->size, this->block_size - b->size);
+      if (r < 0 && errno == EINTR)
+        continue;
+      if (r <= 0) {
+        ok = r == 0;
+        break;
+      }
+      b->size += r;
+    }
+  }
+#if defined(HAVE_ZLIB) || defined(HAVE_ZSTD)
+  else {
+    std::vector<char> in(b->data, b->data + n);
+    in.resize(this->block_size);
+    std::size_t avail = n;
+    bool eof = false;
+    // Refill the input buffer once the decoder has used it all.
+    auto refill = [&]() -> bool {
+      ssize_t r;
+      do
+        r = ::read(fd, &in[0], in.size());
+      while (r < 0 && errno == EINTR);
+      if (r < 0)
+        return false;
+      eof = r == 0;
+      avail = r;
+      return true;
+    };
+
+#ifdef HAVE_ZLIB
+    if (fmt == gzip) {
+      z_stream zs;
+      std::memset(&zs, 0, sizeof(zs));
+      ok = inflateInit2(&zs, 15 + 32) == Z_OK;
+      zs.next_in = reinterpret_cast<Bytef *>(&in[0]);
+      zs.avail_in = avail;
+      while (ok && b != NULL) {
+        if (b->size == this->block_size) {
+          this->publish(false);
+          b = this->acquire(f, false);
+          continue;
+        }
+        if (zs.avail_in == 0 && !eof) {
+          if (!(ok = refill()))
+            break;
+          zs.next_in = reinterpret_cast<Bytef *>(&in[0]);
+          zs.avail_in = avail;
+        }
+        zs.next_out = reinterpret_cast<Bytef *>(b->data + b->size);
+        zs.avail_out = this->block_size - b->size;
+        int r = inflate(&zs, Z_NO_FLUSH);
+        b->size = this->block_size - zs.avail_out;
+        if (r == Z_STREAM_END) {
+          // Concatenated gzip members are one document.
+          if (zs.avail_in == 0 && !eof) {
+            if (!(ok = refill()))
+              break;
+            zs.next_in = reinterpret_cast<Bytef *>(&in[0]);
+            zs.avail_in = avail;
+          }
+          if (zs.avail_in == 0)
+            break;
+          inflateReset(&zs);
+        }
+        else if (r != Z_OK && !(r == Z_BUF_ERROR && !eof))
+          ok = false;
+      }
+      inflateEnd(&zs);
+    }
+#endif
+#ifdef HAVE_ZSTD
+    if (fmt == zstd) {
+      ZSTD_DStream *ds = ZSTD_createDStream();
+      ok = ds != NULL && !ZSTD_isError(ZSTD_initDStream(ds));
+      ZSTD_inBuffer zin = { &in[0], avail, 0 };
+      std::size_t hint = 0;
+      bool flushed = true;
+      while (ok && b != NULL) {
+        if (b->size == this->block_size) {
+          this->publish(false);
+          b = this->acquire(f, false);
+          continue;
+        }
+        // Only ask for more input once the decoder has drained its
+        // own buffers into a block with room to spare.
+        if (zin.pos == zin.size && flushed) {
+          if (eof || !(ok = refill()))
+            break;
+          if (eof)
+            break;
+          zin.size = avail;
+          zin.pos = 0;
+        }
+        ZSTD_outBuffer zout = { b->data, this->block_size, b->size };
+        hint = ZSTD_decompressStream(ds, &zout, &zin);
+        if (ZSTD_isError(hint))
+          ok = false;
+        b->size = zout.pos;
+        flushed = zout.pos < zout.size;
+      }
+      // A non-zero hint at the end means a frame was cut short.
+      if (ok && hint != 0)
+        ok = false;
+      ZSTD_freeDStream(ds);
+    }
+#endif
+  }
+#endif
+
+  if (b != NULL)
+    this->publish(true);
+  if (!is_stdin)
+    ::close(fd);
+  return ok;
+}
+
+}
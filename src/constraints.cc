@@ -0,0 +1,106 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <config.h>
+#include <constraints.hh>
+#include <tokens.hh>
+
+#include <algorithm>
+#include <utility>
+
+namespace markov {
+
+word_set::word_set(std::size_t n) : bits((n + 63) / 64, 0) {
+}
+
+void word_set::insert(token t) {
+  if (t == no_token || t == document_break)
+    return;
+  std::size_t i = t >> 6;
+  if (i >= this->bits.size())
+    this->bits.resize(i + 1, 0);
+  this->bits[i] |= std::uint64_t(1) << (t & 63);
+}
+
+void word_set::erase(token t) {
+  std::size_t i = t >> 6;
+  if (i < this->bits.size())
+    this->bits[i] &= ~(std::uint64_t(1) << (t & 63));
+}
+
+bool word_set::empty() const {
+  for (std::size_t i = 0; i < this->bits.size(); i++)
+    if (this->bits[i])
+      return false;
+  return true;
+}
+
+void word_set::clear() {
+  std::fill(this->bits.begin(), this->bits.end(), 0);
+}
+
+endings::endings(const model& mod, const word_set& ends) :
+  terminals(ends), dist(mod.size(), unreachable) {
+  if (ends.empty())
+    return;
+  std::size_t nstates = mod.size();
+  std::size_t len = mod.prefixLength();
+
+  // Gather the edges between states backwards, grouped by the state
+  // they lead to, and start from the states a terminal word follows.
+  std::vector<model::state> queue;
+  std::vector<std::pair<model::state, model::state> > edges;
+  std::vector<token> next(len);
+  for (model::state st = 0; st < nstates; st++) {
+    const model::successor_list& suf = mod.successors(st);
+    const token *pref = mod.prefixOf(st);
+    std::copy(pref + 1, pref + len, next.begin());
+    for (std::size_t j = 0; j < suf.size(); j++) {
+      if (this->terminals.contains(suf[j].word)) {
+        if (this->dist[st] == unreachable) {
+          this->dist[st] = 1;
+          queue.push_back(st);
+        }
+        continue;
+      }
+      next[len - 1] = suf[j].word;
+      model::state to = mod.find(next.data());
+      if (to != model::no_state)
+        edges.push_back(std::make_pair(to, st));
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+  std::vector<std::size_t> first(nstates + 1, 0);
+  for (std::size_t e = 0; e < edges.size(); e++)
+    first[edges[e].first + 1]++;
+  for (std::size_t s = 0; s < nstates; s++)
+    first[s + 1] += first[s];
+
+  for (std::size_t q = 0; q < queue.size(); q++) {
+    model::state st = queue[q];
+    for (std::size_t e = first[st]; e < first[st + 1]; e++) {
+      model::state from = edges[e].second;
+      if (this->dist[from] == unreachable) {
+        this->dist[from] = this->dist[st] + 1;
+        queue.push_back(from);
+      }
+    }
+  }
+}
+
+}
@@ -0,0 +1,506 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <config.h>
+#include <corpus.hh>
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(HAVE_LINUX_IO_URING_H) && HAVE_DECL___NR_IO_URING_SETUP
+#define MARKOV_USE_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace markov {
+
+struct corpus_reader::slot {
+  char *data;
+  std::size_t len;
+  long result;
+  bool done;
+  int fd;
+  std::size_t file;
+  unsigned long long offset;
+  bool first;
+  bool last;
+  bool stream;
+  struct iovec iov;
+};
+
+class corpus_reader::engine {
+public:
+  virtual ~engine() {}
+  virtual const char *name() const = 0;
+  virtual void submit(slot& s) = 0;
+  virtual void flush() = 0;
+  virtual void wait(slot& s) = 0;
+};
+
+#ifdef MARKOV_USE_URING
+
+// A minimal io_uring driver using the raw system calls, so that
+// liburing is not needed.  Only the consumer thread touches it.
+class corpus_reader::uring_engine : public corpus_reader::engine {
+public:
+  static uring_engine *create(unsigned entries, std::vector<slot>& slots) {
+    uring_engine *e = new uring_engine(slots);
+    if (!e->setup(entries)) {
+      delete e;
+      e = NULL;
+    }
+    return e;
+  }
+
+  ~uring_engine() {
+    if (this->sqes != MAP_FAILED)
+      ::munmap(this->sqes, this->sqes_sz);
+    if (this->cq_ptr != MAP_FAILED && this->cq_ptr != this->sq_ptr)
+      ::munmap(this->cq_ptr, this->cq_sz);
+    if (this->sq_ptr != MAP_FAILED)
+      ::munmap(this->sq_ptr, this->sq_sz);
+    if (this->fd >= 0)
+      ::close(this->fd);
+  }
+
+  const char *name() const {
+    return "io_uring";
+  }
+
+  void submit(slot& s) {
+    unsigned tail = *this->sq_tail;
+    unsigned idx = tail & *this->sq_mask;
+    io_uring_sqe *sqe = &this->sqes[idx];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READV;
+    sqe->fd = s.fd;
+    sqe->addr = reinterpret_cast<unsigned long>(&s.iov);
+    sqe->len = 1;
+    sqe->off = s.offset;
+    sqe->user_data = &s - &this->slots[0];
+    this->sq_array[idx] = idx;
+    __atomic_store_n(this->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    this->pending++;
+  }
+
+  void flush() {
+    while (this->pending > 0) {
+      int r = this->enter(0, 0);
+      if (r < 0)
+        break;
+    }
+  }
+
+  void wait(slot& s) {
+    while (!s.done) {
+      this->reap();
+      if (s.done)
+        break;
+      if (this->enter(1, IORING_ENTER_GETEVENTS) < 0) {
+        // The ring is unusable; fail the read rather than hang.
+        s.result = -errno;
+        s.done = true;
+      }
+    }
+  }
+
+private:
+  std::vector<slot>& slots;
+  int fd;
+  unsigned pending;
+  void *sq_ptr;
+  std::size_t sq_sz;
+  void *cq_ptr;
+  std::size_t cq_sz;
+  io_uring_sqe *sqes;
+  std::size_t sqes_sz;
+  unsigned *sq_tail;
+  unsigned *sq_mask;
+  unsigned *sq_array;
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned *cq_mask;
+  io_uring_cqe *cqes;
+
+  explicit uring_engine(std::vector<slot>& slots) :
+    slots(slots), fd(-1), pending(0), sq_ptr(MAP_FAILED), sq_sz(0),
+    cq_ptr(MAP_FAILED), cq_sz(0),
+    sqes(static_cast<io_uring_sqe *>(MAP_FAILED)), sqes_sz(0) {}
+
+  bool setup(unsigned entries) {
+    io_uring_params p;
+    std::memset(&p, 0, sizeof(p));
+    this->fd = ::syscall(__NR_io_uring_setup, entries, &p);
+    if (this->fd < 0)
+      return false;
+
+    this->sq_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    this->cq_sz = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    bool single = false;
+#ifdef IORING_FEAT_SINGLE_MMAP
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+      single = true;
+      this->sq_sz = this->cq_sz = std::max(this->sq_sz, this->cq_sz);
+    }
+#endif
+    this->sq_ptr = ::mmap(NULL, this->sq_sz, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, this->fd,
+                          IORING_OFF_SQ_RING);
+    if (this->sq_ptr == MAP_FAILED)
+      return false;
+    if (single)
+      this->cq_ptr = this->sq_ptr;
+    else {
+      this->cq_ptr = ::mmap(NULL, this->cq_sz, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, this->fd,
+                            IORING_OFF_CQ_RING);
+      if (this->cq_ptr == MAP_FAILED)
+        return false;
+    }
+    this->sqes_sz = p.sq_entries * sizeof(io_uring_sqe);
+    this->sqes = static_cast<io_uring_sqe *>(
+      ::mmap(NULL, this->sqes_sz, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, this->fd, IORING_OFF_SQES));
+    if (this->sqes == MAP_FAILED)
+      return false;
+
+    char *sq = static_cast<char *>(this->sq_ptr);
+    char *cq = static_cast<char *>(this->cq_ptr);
+    this->sq_tail = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+    this->sq_mask = reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+    this->sq_array = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+    this->cq_head = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+    this->cq_tail = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+    this->cq_mask = reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+    this->cqes = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+    return true;
+  }
+
+  int enter(unsigned min_complete, unsigned flags) {
+    int r;
+    do
+      r = ::syscall(__NR_io_uring_enter, this->fd, this->pending,
+                    min_complete, flags, NULL, 0);
+    while (r < 0 && errno == EINTR);
+    if (r > 0)
+      this->pending -= std::min<unsigned>(r, this->pending);
+    return r;
+  }
+
+  void reap() {
+    unsigned head = *this->cq_head;
+    unsigned tail = __atomic_load_n(this->cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+      io_uring_cqe *cqe = &this->cqes[head & *this->cq_mask];
+      slot& s = this->slots[cqe->user_data];
+      s.result = cqe->res;
+      s.done = true;
+    }
+    __atomic_store_n(this->cq_head, head, __ATOMIC_RELEASE);
+  }
+};
+
+#endif
+
+// The portable fallback: a few threads doing blocking preads.
+class corpus_reader::pool_engine : public corpus_reader::engine {
+public:
+  explicit pool_engine(unsigned nthreads) : stopping(false) {
+    for (unsigned i = 0; i < nthreads; i++)
+      this->threads.push_back(std::thread(&pool_engine::run, this));
+  }
+
+  ~pool_engine() {
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->stopping = true;
+    }
+    this->work.notify_all();
+    for (std::size_t i = 0; i < this->threads.size(); i++)
+      this->threads[i].join();
+  }
+
+  const char *name() const {
+    return "pread";
+  }
+
+  void submit(slot& s) {
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->queue.push_back(&s);
+    }
+    this->work.notify_one();
+  }
+
+  void flush() {}
+
+  void wait(slot& s) {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    this->finished.wait(lock, [&s] { return s.done; });
+  }
+
+private:
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable work;
+  std::condition_variable finished;
+  std::deque<slot *> queue;
+  bool stopping;
+
+  void run() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    for (;;) {
+      this->work.wait(lock, [this] {
+        return this->stopping || !this->queue.empty();
+      });
+      if (this->queue.empty())
+        return;
+      slot *s = this->queue.front();
+      this->queue.pop_front();
+      lock.unlock();
+      ssize_t n = ::pread(s->fd, s->data, s->len, s->offset);
+      long result = n < 0 ? -errno : n;
+      lock.lock();
+      s->result = result;
+      s->done = true;
+      this->finished.notify_all();
+    }
+  }
+};
+
+corpus_reader::corpus_reader(const std::vector<std::string>& files,
+                             std::size_t block_size, unsigned depth,
+                             bool use_uring) :
+  files(files), block_size(block_size ? block_size : 1 << 18),
+  slots(depth ? depth : 1), head(0), inflight(0), holding(false),
+  next_file(0), cur_file(0), cur_fd(-1), cur_stream(false), cur_off(0),
+  cur_size(0), nbytes(0) {
+  for (std::size_t i = 0; i < this->slots.size(); i++) {
+    slot& s = this->slots[i];
+    void *p = NULL;
+    if (::posix_memalign(&p, 4096, this->block_size) != 0)
+      throw std::bad_alloc();
+    s.data = static_cast<char *>(p);
+    s.done = false;
+    s.fd = -1;
+    s.last = false;
+    s.stream = false;
+  }
+#ifdef MARKOV_USE_URING
+  if (use_uring)
+    this->io.reset(uring_engine::create(this->slots.size(), this->slots));
+#else
+  (void)use_uring;
+#endif
+  if (!this->io)
+    this->io.reset(new pool_engine(std::min<std::size_t>(this->slots.size(),
+                                                         8)));
+}
+
+corpus_reader::~corpus_reader() {
+  if (this->holding) {
+    this->release(this->slots[this->head]);
+    this->head = (this->head + 1) % this->slots.size();
+    this->inflight--;
+  }
+  for (; this->inflight > 0; this->inflight--) {
+    slot& s = this->slots[this->head];
+    this->io->wait(s);
+    this->release(s);
+    this->head = (this->head + 1) % this->slots.size();
+  }
+  this->io.reset();
+  if (this->cur_fd >= 0)
+    ::close(this->cur_fd);
+  for (std::size_t i = 0; i < this->slots.size(); i++)
+    std::free(this->slots[i].data);
+}
+
+// Choose the next block to read, opening the next file when the
+// current one is used up.  The slot holding a file's last block takes
+// over its descriptor and closes it when released.
+//
+// Pipes, FIFOs and other files that are not regular have no size and
+// cannot be read at an offset, so they are read one block at a time,
+// in next, once every earlier block has been handed out.
+bool corpus_reader::plan(slot& s) {
+  while (this->cur_fd < 0) {
+    if (this->next_file >= this->files.size())
+      return false;
+    std::size_t f = this->next_file++;
+    int fd = ::open(this->files[f].c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || ::fstat(fd, &st) < 0) {
+      if (fd >= 0)
+        ::close(fd);
+      this->failed.push_back(this->files[f]);
+      continue;
+    }
+    bool stream = !S_ISREG(st.st_mode);
+    if (!stream && st.st_size == 0) {
+      ::close(fd);
+      continue;
+    }
+#ifdef POSIX_FADV_SEQUENTIAL
+    if (!stream)
+      ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    this->cur_fd = fd;
+    this->cur_file = f;
+    this->cur_stream = stream;
+    this->cur_off = 0;
+    this->cur_size = stream ? 0 : st.st_size;
+  }
+
+  if (this->cur_stream && this->inflight > 0)
+    return false;
+
+  s.fd = this->cur_fd;
+  s.file = this->cur_file;
+  s.offset = this->cur_off;
+  s.stream = this->cur_stream;
+  s.first = this->cur_off == 0;
+  if (s.stream) {
+    s.len = this->block_size;
+    s.last = false;
+  }
+  else {
+    s.len = std::min<unsigned long long>(this->block_size,
+                                         this->cur_size - this->cur_off);
+    this->cur_off += s.len;
+    s.last = this->cur_off >= this->cur_size;
+    if (s.last)
+      this->cur_fd = -1;
+  }
+  s.iov.iov_base = s.data;
+  s.iov.iov_len = s.len;
+  s.result = 0;
+  s.done = s.stream;
+  return true;
+}
+
+// Fill a block from a pipe or other stream.  A stream's end is only
+// seen when a read returns nothing, so its last block may be empty.
+void corpus_reader::fill(slot& s) {
+  std::size_t got = 0;
+  while (got < s.len) {
+    ssize_t n = ::read(s.fd, s.data + got, s.len - got);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      s.result = -errno;
+    if (n <= 0) {
+      s.last = true;
+      this->cur_fd = -1;
+      break;
+    }
+    got += n;
+  }
+  if (s.result >= 0)
+    s.result = got;
+  this->cur_off += got;
+}
+
+void corpus_reader::release(slot& s) {
+  if (s.last && s.fd >= 0)
+    ::close(s.fd);
+  s.fd = -1;
+  s.last = false;
+}
+
+bool corpus_reader::next(buffer& buf) {
+  if (this->holding) {
+    this->release(this->slots[this->head]);
+    this->head = (this->head + 1) % this->slots.size();
+    this->inflight--;
+    this->holding = false;
+  }
+
+  bool submitted = false;
+  while (this->inflight < this->slots.size()) {
+    slot& s = this->slots[(this->head + this->inflight) % this->slots.size()];
+    if (!this->plan(s))
+      break;
+    this->inflight++;
+    if (s.stream)
+      continue;
+    this->io->submit(s);
+    submitted = true;
+  }
+  if (submitted)
+    this->io->flush();
+
+  if (this->inflight == 0)
+    return false;
+
+  slot& s = this->slots[this->head];
+  if (s.stream)
+    this->fill(s);
+  else
+    this->io->wait(s);
+  this->holding = true;
+
+  // Regular files rarely come up short, but if one does, finish the
+  // block synchronously rather than split a word at a false boundary.
+  std::size_t got = s.result > 0 ? s.result : 0;
+  while (!s.stream && s.result >= 0 && got < s.len) {
+    ssize_t n = ::pread(s.fd, s.data + got, s.len - got, s.offset + got);
+    if (n <= 0)
+      break;
+    got += n;
+  }
+  if (s.result < 0 && (this->failed.empty()
+                       || this->failed.back() != this->files[s.file]))
+    this->failed.push_back(this->files[s.file]);
+
+  buf.data = s.data;
+  buf.size = got;
+  buf.document = s.file;
+  buf.first = s.first;
+  buf.last = s.last;
+  this->nbytes += got;
+  return true;
+}
+
+const char *corpus_reader::backend() const {
+  return this->io->name();
+}
+
+unsigned long long corpus_reader::bytes() const {
+  return this->nbytes;
+}
+
+const std::vector<std::string>& corpus_reader::errors() const {
+  return this->failed;
+}
+
+}
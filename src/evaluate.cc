@@ -0,0 +1,436 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <config.h>
+#include <evaluate.hh>
+#include <compress.hh>
+#include <corpus.hh>
+#include "words.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cmath>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace markov {
+
+static const std::size_t evaluate_block_size = 1 << 16;
+static const unsigned evaluate_depth = 16;
+static const unsigned long long evaluate_min_range = 1 << 20;
+
+smoothed_model::smoothed_model(const model& m) : full(m), ntokens(0) {
+  for (std::size_t len = m.prefixLength(); len > 1; len--)
+    this->shorter.push_back(
+      this->shorter.empty() ? m.reduce() : this->shorter.back().reduce());
+  std::reverse(this->shorter.begin(), this->shorter.end());
+
+  const model& one = this->shorter.empty() ? m : this->shorter.front();
+  this->unigrams.assign(m.words().size(), 0);
+  for (model::state st = 0; st < one.size(); st++) {
+    const model::successor_list& suf = one.successors(st);
+    for (std::size_t j = 0; j < suf.size(); j++)
+      this->unigrams[suf[j].word] += suf[j].count;
+    this->ntokens += one.total(st);
+  }
+}
+
+const model& smoothed_model::base() const {
+  return this->full;
+}
+
+double smoothed_model::logProb(const token *history, std::size_t hlen,
+                               token w, std::size_t *context,
+                               std::size_t *match) const {
+  std::size_t len = this->full.prefixLength();
+  std::size_t h = std::min(hlen, len);
+  double p = (this->unigrams[w] + 1.0)
+    / (this->ntokens + this->unigrams.size());
+  std::size_t ctx = 0;
+  std::size_t mt = 0;
+
+  // Every tail of a prefix in a model is a prefix in the next shorter
+  // one, so the first tail that is missing ends the search.
+  for (std::size_t k = 1; k <= h; k++) {
+    const model& mk = k == len ? this->full : this->shorter[k - 1];
+    model::state st = mk.find(history + hlen - k);
+    if (st == model::no_state)
+      break;
+    ctx = k;
+    std::uint32_t c = mk.count(st, w);
+    if (c)
+      mt = k;
+    double d = static_cast<double>(mk.successors(st).size());
+    p = (c + d * p) / (mk.total(st) + d);
+  }
+
+  if (context)
+    *context = ctx;
+  if (match)
+    *match = mt;
+  return std::log(p);
+}
+
+double evaluation::perplexity() const {
+  return this->scored ? std::exp(-this->logprob / this->scored) : 0;
+}
+
+double evaluation::oovRate() const {
+  return this->tokens ? static_cast<double>(this->oov) / this->tokens : 0;
+}
+
+double evaluation::deadEndRate() const {
+  return this->scored
+    ? static_cast<double>(this->dead_ends) / this->scored : 0;
+}
+
+namespace {
+
+// Count the bytes handed out by another source.
+class counting_source : public source {
+public:
+  counting_source(source& s) : in(s), bytes(0) {}
+  bool next(buffer& buf) {
+    if (!this->in.next(buf))
+      return false;
+    this->bytes += buf.size;
+    return true;
+  }
+  source& in;
+  unsigned long long bytes;
+};
+
+// Score every word of a source into ev, without touching bytes,
+// seconds or errors.  hist holds the words before the source's first
+// block when that block does not start a document.
+void score(const smoothed_model& m, source& in, evaluation& ev,
+           std::vector<token> hist = std::vector<token>())
+{
+  const model& full = m.base();
+  const vocabulary& vocab = full.words();
+  std::size_t len = full.prefixLength();
+  hist.reserve(len);
+
+  splitWords(in,
+             [&](std::string_view w) {
+               ev.tokens++;
+               token t = vocab.find(w);
+               if (t == no_token)
+                 ev.oov++;
+               else {
+                 std::size_t ctx, mt;
+                 ev.logprob += m.logProb(hist.data(), hist.size(), t,
+                                         &ctx, &mt);
+                 ev.scored++;
+                 if (hist.size() == len) {
+                   if (ctx < len)
+                     ev.dead_ends++;
+                   else if (mt < len)
+                     ev.unseen++;
+                 }
+               }
+               if (hist.size() == len)
+                 hist.erase(hist.begin());
+               hist.push_back(t);
+             },
+             [&](std::size_t) { hist.clear(); });
+}
+
+template <class Reader>
+void scoreBatch(const smoothed_model& m, Reader& reader, evaluation& ev)
+{
+  score(m, reader, ev);
+  ev.bytes += reader.bytes();
+  ev.errors.insert(ev.errors.end(), reader.errors().begin(),
+                   reader.errors().end());
+}
+
+// Read a byte range of an open file, a block at a time, as part of
+// one document.  Only a range at the start of the file starts it.
+class range_source : public source {
+public:
+  range_source(int fd, std::size_t document, unsigned long long begin,
+               unsigned long long end) :
+    fd(fd), document(document), begin(begin), off(begin), end(end),
+    block(evaluate_block_size), failed(false) {}
+
+  bool next(buffer& buf) {
+    if (this->off >= this->end || this->failed)
+      return false;
+    std::size_t len = std::min<unsigned long long>(this->block.size(),
+                                                   this->end - this->off);
+    std::size_t got = 0;
+    while (got < len) {
+      ssize_t n = ::pread(this->fd, this->block.data() + got, len - got,
+                          this->off + got);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0) {
+        this->failed = true;
+        break;
+      }
+      got += n;
+    }
+    buf.data = this->block.data();
+    buf.size = got;
+    buf.document = this->document;
+    buf.first = this->off == 0;
+    this->off += got;
+    buf.last = this->off >= this->end || this->failed;
+    return true;
+  }
+
+  unsigned long long bytes() const {
+    return this->off - this->begin;
+  }
+
+  int fd;
+  std::size_t document;
+  unsigned long long begin;
+  unsigned long long off;
+  unsigned long long end;
+  std::vector<char> block;
+  bool failed;
+};
+
+// The first whitespace byte at or after pos, or size if there is
+// none.  Ranges are cut there so that no word spans two of them.
+unsigned long long cutAt(int fd, unsigned long long pos,
+                         unsigned long long size)
+{
+  if (pos == 0)
+    return 0;
+  char chunk[4096];
+  while (pos < size) {
+    ssize_t n = ::pread(fd, chunk, std::min<unsigned long long>(
+                          sizeof(chunk), size - pos), pos);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return size;
+    for (ssize_t i = 0; i < n; i++)
+      if (isSpace(chunk[i]))
+        return pos + i;
+    pos += n;
+  }
+  return size;
+}
+
+// The ids of the last words, up to the prefix length, before a cut,
+// oldest first, as the history would hold them had the file been
+// read from the start.
+std::vector<token> historyAt(int fd, unsigned long long cut,
+                             const model& m)
+{
+  std::size_t len = m.prefixLength();
+  std::vector<std::string_view> words;
+  std::vector<char> window;
+  for (unsigned long long want = 4096; ; want *= 2) {
+    unsigned long long lo = cut > want ? cut - want : 0;
+    window.resize(cut - lo);
+    std::size_t got = 0;
+    while (got < window.size()) {
+      ssize_t n = ::pread(fd, window.data() + got, window.size() - got,
+                          lo + got);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        break;
+      got += n;
+    }
+    if (got < window.size())
+      return std::vector<token>();
+
+    // Words are taken from the end; one that touches the start of the
+    // window may be cut off, unless the window starts the file.
+    words.clear();
+    bool complete = true;
+    std::size_t i = window.size();
+    while (words.size() < len) {
+      while (i > 0 && isSpace(window[i - 1]))
+        i--;
+      if (i == 0)
+        break;
+      std::size_t j = i;
+      while (j > 0 && !isSpace(window[j - 1]))
+        j--;
+      if (j == 0 && lo > 0) {
+        complete = false;
+        break;
+      }
+      words.push_back(std::string_view(window.data() + j, i - j));
+      i = j;
+    }
+    if (complete || lo == 0)
+      break;
+  }
+
+  std::vector<token> hist;
+  for (std::size_t k = words.size(); k > 0; k--)
+    hist.push_back(m.words().find(words[k - 1]));
+  return hist;
+}
+
+// Score one range of a file into ev.
+void scoreRange(const smoothed_model& m, const std::string& name,
+                unsigned long long begin, unsigned long long end,
+                unsigned long long size, evaluation& ev)
+{
+  int fd = ::open(name.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    ev.errors.push_back(name);
+    return;
+  }
+  begin = cutAt(fd, begin, size);
+  end = cutAt(fd, end, size);
+  if (begin < end) {
+    range_source in(fd, 0, begin, end);
+    score(m, in, ev, begin ? historyAt(fd, begin, m.base())
+                           : std::vector<token>());
+    ev.bytes += in.bytes();
+    if (in.failed)
+      ev.errors.push_back(name);
+  }
+  ::close(fd);
+}
+
+// A unit of work: either a batch of whole files, or one range of a
+// file too big to leave to a single thread.
+struct piece {
+  std::vector<std::string> names;
+  unsigned long long begin;
+  unsigned long long end;
+  unsigned long long size;
+};
+
+evaluation emptyEvaluation()
+{
+  evaluation ev;
+  ev.tokens = 0;
+  ev.oov = 0;
+  ev.dead_ends = 0;
+  ev.unseen = 0;
+  ev.scored = 0;
+  ev.logprob = 0;
+  ev.bytes = 0;
+  ev.seconds = 0;
+  return ev;
+}
+
+}
+
+evaluation evaluate(const smoothed_model& m, source& in) {
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+  evaluation ev = emptyEvaluation();
+  counting_source counted(in);
+  score(m, counted, ev);
+  ev.bytes = counted.bytes;
+  std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+  ev.seconds = d.count();
+  return ev;
+}
+
+evaluation evaluate(const smoothed_model& m,
+                    const std::vector<std::string>& files,
+                    unsigned threads, std::size_t batch) {
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  if (batch == 0)
+    batch = 1;
+
+  // Big, plain files are split into ranges when there are threads to
+  // share them; everything else goes in batches of whole files.
+  std::vector<piece> pieces;
+  for (std::size_t i = 0; i < files.size(); i++) {
+    struct stat st;
+    if (threads > 1 && !compressed_reader::compressedName(files[i])
+        && ::stat(files[i].c_str(), &st) == 0 && S_ISREG(st.st_mode)
+        && static_cast<unsigned long long>(st.st_size)
+             >= 2 * evaluate_min_range) {
+      unsigned long long size = st.st_size;
+      unsigned long long n = std::min<unsigned long long>(
+        size / evaluate_min_range, 4ULL * threads);
+      for (unsigned long long k = 0; k < n; k++)
+        pieces.push_back(piece{std::vector<std::string>(1, files[i]),
+                               size * k / n, size * (k + 1) / n, size});
+      continue;
+    }
+    if (pieces.empty() || pieces.back().size > 0
+        || pieces.back().names.size() >= batch)
+      pieces.push_back(piece{std::vector<std::string>(), 0, 0, 0});
+    pieces.back().names.push_back(files[i]);
+  }
+  if (threads > pieces.size())
+    threads = std::max<std::size_t>(pieces.size(), 1);
+
+  std::vector<evaluation> parts(threads, emptyEvaluation());
+  std::atomic<std::size_t> cursor(0);
+
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; t++) {
+    workers.push_back(std::thread([&, t] {
+      evaluation& ev = parts[t];
+      std::size_t i;
+      while ((i = cursor.fetch_add(1)) < pieces.size()) {
+        const piece& p = pieces[i];
+        if (p.size > 0)
+          scoreRange(m, p.names[0], p.begin, p.end, p.size, ev);
+        else if (std::any_of(p.names.begin(), p.names.end(),
+                             compressed_reader::compressedName)) {
+          compressed_reader reader(p.names, evaluate_block_size);
+          scoreBatch(m, reader, ev);
+        }
+        else {
+          corpus_reader reader(p.names, evaluate_block_size, evaluate_depth);
+          scoreBatch(m, reader, ev);
+        }
+      }
+    }));
+  }
+  for (unsigned t = 0; t < threads; t++)
+    workers[t].join();
+
+  evaluation ev = emptyEvaluation();
+  for (unsigned t = 0; t < threads; t++) {
+    ev.tokens += parts[t].tokens;
+    ev.oov += parts[t].oov;
+    ev.dead_ends += parts[t].dead_ends;
+    ev.unseen += parts[t].unseen;
+    ev.scored += parts[t].scored;
+    ev.logprob += parts[t].logprob;
+    ev.bytes += parts[t].bytes;
+    // Each range of a file that cannot be read reports it.
+    for (std::size_t k = 0; k < parts[t].errors.size(); k++)
+      if (std::find(ev.errors.begin(), ev.errors.end(), parts[t].errors[k])
+          == ev.errors.end())
+        ev.errors.push_back(parts[t].errors[k]);
+  }
+  std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+  ev.seconds = d.count();
+  return ev;
+}
+
+}
@@ -0,0 +1,218 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <config.h>
+#include <ingest.hh>
+#include <compress.hh>
+#include <corpus.hh>
+#include "words.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+
+namespace markov {
+
+namespace fs = std::filesystem;
+
+// Small files dominate, so keep each per-batch reader cheap to set up.
+static const std::size_t ingest_block_size = 1 << 16;
+static const unsigned ingest_depth = 16;
+
+// The words at either end of a file, kept so that files trained
+// apart can be joined up afterwards.  tail is a ring of the last
+// words, word i of the file going in tail[i % tail.size()].
+struct file_ends {
+  std::vector<std::string> head;
+  std::vector<std::string> tail;
+  std::size_t words;
+};
+
+// Train a batch of files, each as a document, and given ends, record
+// the first and last words of file first + d in ends[first + d].
+template <class Reader>
+static void trainBatch(chain& c, Reader& reader, unsigned long long& bytes,
+                       std::vector<std::string>& errors, file_ends *ends,
+                       std::size_t first)
+{
+  if (!ends)
+    c.add(reader, true);
+  else {
+    std::size_t len = c.prefixLength();
+    file_ends *e = NULL;
+    splitWords(reader,
+               [&c, &e, len](std::string_view w) {
+                 c.add(std::string(w));
+                 if (e->head.size() < len)
+                   e->head.push_back(std::string(w));
+                 e->tail[e->words++ % len].assign(w);
+               },
+               [&c, &e, ends, first, len](std::size_t d) {
+                 c.reset();
+                 e = &ends[first + d];
+                 e->tail.resize(len);
+               });
+  }
+  bytes += reader.bytes();
+  errors.insert(errors.end(), reader.errors().begin(), reader.errors().end());
+}
+
+// Add the transitions that run from each file into the next, as
+// training the files one after another would have.  Every file's own
+// transitions are already in c, so only those whose prefix holds
+// words from before the file are added: those of its first words,
+// after the last words of the files before it.
+static void joinFiles(chain& c, const std::vector<file_ends>& ends)
+{
+  std::size_t len = c.prefixLength();
+  chain glue(len);
+  std::vector<std::string> last;
+  for (std::size_t i = 0; i < ends.size(); i++) {
+    const file_ends& e = ends[i];
+    if (e.words == 0)
+      continue;
+    glue.reset();
+    for (std::size_t k = 0; k < last.size(); k++)
+      glue.add(last[k]);
+    for (std::size_t k = 0; k < e.head.size(); k++)
+      glue.add(e.head[k]);
+
+    if (e.words >= len) {
+      last.clear();
+      for (std::size_t k = 0; k < len; k++)
+        last.push_back(e.tail[(e.words + k) % len]);
+    }
+    else {
+      last.insert(last.end(), e.head.begin(), e.head.end());
+      if (last.size() > len)
+        last.erase(last.begin(), last.end() - len);
+    }
+  }
+  c.merge(std::move(glue));
+}
+
+double ingest_stats::filesPerSecond() const {
+  return this->seconds > 0 ? this->files / this->seconds : 0.0;
+}
+
+double ingest_stats::megabytesPerSecond() const {
+  return this->seconds > 0 ? this->bytes / this->seconds / (1 << 20) : 0.0;
+}
+
+std::vector<std::string> listDirectory(const std::string& dir,
+                                       bool recursive) {
+  std::vector<std::string> files;
+  std::error_code ec;
+  if (recursive) {
+    fs::recursive_directory_iterator it(
+      dir, fs::directory_options::skip_permission_denied, ec);
+    for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+      if (it->is_regular_file(ec))
+        files.push_back(it->path().string());
+  }
+  else {
+    fs::directory_iterator it(
+      dir, fs::directory_options::skip_permission_denied, ec);
+    for (; !ec && it != fs::directory_iterator(); it.increment(ec))
+      if (it->is_regular_file(ec))
+        files.push_back(it->path().string());
+  }
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+std::vector<std::string> readManifest(std::istream& in) {
+  std::vector<std::string> files;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (!line.empty() && line[line.size() - 1] == '\r')
+      line.erase(line.size() - 1);
+    if (!line.empty())
+      files.push_back(line);
+  }
+  return files;
+}
+
+ingest_stats ingest(chain& c, const std::vector<std::string>& files,
+                    unsigned threads, std::size_t batch, bool resetprefix) {
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  if (batch == 0)
+    batch = 1;
+  std::size_t nbatches = (files.size() + batch - 1) / batch;
+  if (threads > nbatches)
+    threads = std::max<std::size_t>(nbatches, 1);
+
+  struct worker_state {
+    chain part;
+    unsigned long long bytes;
+    std::vector<std::string> errors;
+  };
+  std::vector<worker_state> states(threads,
+    worker_state{chain(c.prefixLength()), 0, std::vector<std::string>()});
+  std::vector<file_ends> ends(resetprefix ? 0 : files.size(),
+                              file_ends{std::vector<std::string>(),
+                                        std::vector<std::string>(), 0});
+  file_ends *keep = resetprefix ? NULL : ends.data();
+  std::atomic<std::size_t> cursor(0);
+
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; t++) {
+    workers.push_back(std::thread([&, t] {
+      worker_state& st = states[t];
+      std::size_t first;
+      while ((first = cursor.fetch_add(batch)) < files.size()) {
+        std::size_t last = std::min(first + batch, files.size());
+        std::vector<std::string> names(files.begin() + first,
+                                       files.begin() + last);
+        if (std::any_of(names.begin(), names.end(),
+                        compressed_reader::compressedName)) {
+          compressed_reader reader(names, ingest_block_size, ingest_depth);
+          trainBatch(st.part, reader, st.bytes, st.errors, keep, first);
+        }
+        else {
+          corpus_reader reader(names, ingest_block_size, ingest_depth);
+          trainBatch(st.part, reader, st.bytes, st.errors, keep, first);
+        }
+      }
+    }));
+  }
+  for (unsigned t = 0; t < threads; t++)
+    workers[t].join();
+
+  ingest_stats stats;
+  stats.bytes = 0;
+  for (unsigned t = 0; t < threads; t++) {
+    c.merge(std::move(states[t].part));
+    stats.bytes += states[t].bytes;
+    stats.errors.insert(stats.errors.end(), states[t].errors.begin(),
+                        states[t].errors.end());
+  }
+  if (!resetprefix)
+    joinFiles(c, ends);
+  stats.files = files.size() - stats.errors.size();
+  std::chrono::duration<double> d = std::chrono::steady_clock::now() - start;
+  stats.seconds = d.count();
+  return stats;
+}
+
+}
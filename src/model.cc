@@ -0,0 +1,884 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <config.h>
+#include <chain.hh>
+#include <model.hh>
+#include <philox.hh>
+#include <tokens.hh>
+#include "words.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+namespace markov {
+
+namespace {
+
+// A state with more successors than this keeps a hash index of them
+// while training, and running sums once frozen.
+const std::size_t hash_fanout = 32;
+
+// A frozen state with at least this many successors gets an alias
+// table instead of running sums.
+const std::size_t alias_fanout = 1024;
+
+const std::uint32_t empty_slot = 0xffffffff;
+
+// The slot for t in an open addressed table of positions in suf: the
+// one holding t's position, or the empty slot where it would go.
+std::size_t findSlot(const std::vector<std::uint32_t>& slots,
+                     const model::successor_list& suf, token t)
+{
+  std::size_t mask = slots.size() - 1;
+  std::size_t i = (t * 0x9E3779B97F4A7C15ull) >> 32 & mask;
+  while (slots[i] != empty_slot && suf[slots[i]].word != t)
+    i = (i + 1) & mask;
+  return i;
+}
+
+// Index every successor, with room for the list to double before the
+// table is half full.
+void buildSlots(std::vector<std::uint32_t>& slots,
+                const model::successor_list& suf)
+{
+  std::size_t size = 16;
+  while (size < 4 * suf.size())
+    size *= 2;
+  slots.assign(size, empty_slot);
+  for (std::size_t j = 0; j < suf.size(); j++)
+    slots[findSlot(slots, suf, suf[j].word)] = j;
+}
+
+// Vose's alias method: each entry gets a slot holding the chance of
+// keeping it and another entry to take instead, so a pick is one
+// random slot and one comparison.  scaled holds the weights scaled to
+// a mean of one, and is used up.
+void buildAlias(std::vector<double>& scaled, double *prob,
+                std::uint32_t *alias)
+{
+  std::vector<std::uint32_t> small;
+  std::vector<std::uint32_t> large;
+  for (std::size_t i = 0; i < scaled.size(); i++) {
+    alias[i] = i;
+    (scaled[i] < 1 ? small : large).push_back(i);
+  }
+  while (!small.empty() && !large.empty()) {
+    std::uint32_t s = small.back();
+    std::uint32_t l = large.back();
+    small.pop_back();
+    prob[s] = scaled[s];
+    alias[s] = l;
+    scaled[l] -= 1 - scaled[s];
+    if (scaled[l] < 1) {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+  // What is left is within rounding of one.
+  for (std::size_t i = 0; i < large.size(); i++)
+    prob[large[i]] = 1;
+  for (std::size_t i = 0; i < small.size(); i++)
+    prob[small[i]] = 1;
+}
+
+}
+
+model::model(std::size_t len) :
+  prefix_len(len ? len : 1), table(prefix_len), from(NULL),
+  is_frozen(false), sentence_breaks(false), at_start(true),
+  start_total(0) {
+  this->window.reserve(this->prefix_len);
+}
+
+model::state model::intern(const token *pref) {
+  state s = this->table.intern(pref);
+  if (s == this->suffixes.size()) {
+    this->suffixes.push_back(successor_list());
+    this->totals.push_back(0);
+    this->start_counts.push_back(0);
+  }
+  return s;
+}
+
+std::size_t model::record(state st, token t, std::uint32_t n) {
+  if (this->is_frozen) {
+    this->is_frozen = false;
+    this->index_first.clear();
+    this->index_states.clear();
+    this->start_prob.clear();
+    this->start_alias.clear();
+    this->sums_at.clear();
+    this->sums.clear();
+    this->alias_at.clear();
+    this->alias_prob.clear();
+    this->alias_of.clear();
+  }
+  successor_list& suf = this->suffixes[st];
+  this->totals[st] += n;
+  if (suf.size() > hash_fanout) {
+    std::vector<std::uint32_t>& slots = this->suffix_slots[st];
+    std::size_t k = findSlot(slots, suf, t);
+    if (slots[k] != empty_slot) {
+      suf[slots[k]].count += n;
+      return slots[k];
+    }
+    slots[k] = suf.size();
+    suf.push_back(successor{t, n});
+    if (2 * suf.size() > slots.size())
+      buildSlots(slots, suf);
+    return suf.size() - 1;
+  }
+  std::size_t j = this->position(st, t);
+  if (j < suf.size()) {
+    suf[j].count += n;
+    return j;
+  }
+  suf.push_back(successor{t, n});
+  if (suf.size() > hash_fanout)
+    buildSlots(this->suffix_slots[st], suf);
+  return j;
+}
+
+// The same sliding window as chain::add, over ids.  The first full
+// prefix after the window was cleared is a start state.
+void model::push(token t) {
+  if (this->window.size() == this->prefix_len) {
+    state st = this->intern(this->window.data());
+    this->record(st, t, 1);
+    if (this->at_start) {
+      if (this->start_counts[st]++ == 0)
+        this->start_states.push_back(st);
+      this->start_total++;
+      this->at_start = false;
+    }
+    std::copy(this->window.begin() + 1, this->window.end(),
+              this->window.begin());
+    this->window.back() = t;
+  }
+  else
+    this->window.push_back(t);
+  if (this->sentence_breaks && endsSentence(this->vocab.word(t)))
+    this->reset();
+}
+
+void model::add(token t) {
+  if (t < this->vocab.size())
+    this->push(t);
+}
+
+void model::add(std::string_view w) {
+  this->push(this->vocab.intern(w));
+}
+
+void model::add(source& in, bool resetprefix) {
+  splitWords(in,
+             [this](std::string_view w) { this->add(w); },
+             [this, resetprefix](std::size_t) {
+               if (resetprefix)
+                 this->reset();
+             });
+}
+
+void model::add(const token_file& f, bool resetprefix) {
+  std::vector<token> map;
+  bool same = this->vocab.size() == 0;
+  if (same)
+    this->vocab = f.dictionary();
+  else {
+    map.resize(f.words());
+    for (std::size_t i = 0; i < map.size(); i++)
+      map[i] = this->vocab.intern(f.word(i));
+  }
+
+  std::size_t nwords = f.words();
+  for (const token *p = f.begin(); p != f.end(); p++) {
+    token t = *p;
+    if (t >= nwords) {
+      if (t == document_break && resetprefix)
+        this->reset();
+      continue;
+    }
+    this->push(same ? t : map[t]);
+  }
+}
+
+void model::add(const token *ids, std::size_t n) {
+  std::size_t nwords = this->vocab.size();
+  for (std::size_t i = 0; i < n; i++) {
+    if (ids[i] < nwords)
+      this->push(ids[i]);
+    else if (ids[i] == document_break)
+      this->reset();
+  }
+}
+
+void model::add(const token *ids, std::size_t n, const vocabulary& dict) {
+  if (this->vocab.size() == 0) {
+    this->vocab = dict;
+    this->from = &dict;
+    this->from_ids.clear();
+    for (token t = 0; t < dict.size(); t++)
+      this->from_ids.push_back(t);
+  }
+  else if (this->from != &dict || this->from_ids.size() > dict.size()) {
+    this->from = &dict;
+    this->from_ids.clear();
+  }
+  this->from_ids.resize(dict.size(), no_token);
+
+  for (std::size_t i = 0; i < n; i++) {
+    token t = ids[i];
+    if (t >= this->from_ids.size()) {
+      if (t == document_break)
+        this->reset();
+      continue;
+    }
+    if (this->from_ids[t] == no_token)
+      this->from_ids[t] = this->vocab.intern(dict.word(t));
+    this->push(this->from_ids[t]);
+  }
+}
+
+void model::reset() {
+  this->window.clear();
+  this->at_start = true;
+}
+
+void model::setSentenceBreaks(bool on) {
+  this->sentence_breaks = on;
+}
+
+bool model::sentenceBreaks() const {
+  return this->sentence_breaks;
+}
+
+void model::clear() {
+  this->vocab.clear();
+  this->table.clear();
+  this->suffixes.clear();
+  this->totals.clear();
+  this->window.clear();
+  this->from = NULL;
+  this->from_ids.clear();
+  this->is_frozen = false;
+  this->index_first.clear();
+  this->index_states.clear();
+  this->at_start = true;
+  this->start_counts.clear();
+  this->start_states.clear();
+  this->start_total = 0;
+  this->start_prob.clear();
+  this->start_alias.clear();
+  this->suffix_slots.clear();
+  this->sums_at.clear();
+  this->sums.clear();
+  this->alias_at.clear();
+  this->alias_prob.clear();
+  this->alias_of.clear();
+}
+
+std::size_t model::size() const {
+  return this->suffixes.size();
+}
+
+std::size_t model::prefixLength() const {
+  return this->prefix_len;
+}
+
+const vocabulary& model::words() const {
+  return this->vocab;
+}
+
+model::state model::find(const token *pref) const {
+  return this->table.find(pref);
+}
+
+const token *model::prefixOf(state s) const {
+  return this->table.prefixOf(s);
+}
+
+const model::successor_list& model::successors(state s) const {
+  return this->suffixes[s];
+}
+
+// Most frequent first, then by id.
+static bool moreFrequent(const model::successor& a,
+                         const model::successor& b)
+{
+  return a.count > b.count || (a.count == b.count && a.word < b.word);
+}
+
+void model::freeze(bool index) {
+  for (std::size_t st = 0; st < this->suffixes.size(); st++)
+    std::sort(this->suffixes[st].begin(), this->suffixes[st].end(),
+              moreFrequent);
+  this->buildDraws();
+  this->is_frozen = true;
+  if (index && !this->indexed())
+    this->buildIndex();
+  if (this->start_prob.empty())
+    this->buildStarts();
+}
+
+void model::buildStarts() {
+  std::size_t n = this->start_states.size();
+  this->start_prob.assign(n, 0);
+  this->start_alias.assign(n, 0);
+  std::vector<double> scaled(n);
+  for (std::size_t i = 0; i < n; i++)
+    scaled[i] = static_cast<double>(this->start_counts[this->start_states[i]])
+      * n / this->start_total;
+  buildAlias(scaled, this->start_prob.data(), this->start_alias.data());
+}
+
+// Sorting moved every successor of the hashed states, so their slots
+// are rebuilt.  Those same states, the ones with more successors than
+// a scan should walk, then get running sums or an alias table.
+void model::buildDraws() {
+  this->sums_at.clear();
+  this->sums.clear();
+  this->alias_at.clear();
+  this->alias_prob.clear();
+  this->alias_of.clear();
+  std::vector<double> scaled;
+  for (std::unordered_map<state, std::vector<std::uint32_t> >::iterator it =
+         this->suffix_slots.begin(); it != this->suffix_slots.end(); it++) {
+    const successor_list& suf = this->suffixes[it->first];
+    buildSlots(it->second, suf);
+    std::size_t n = suf.size();
+    if (n >= alias_fanout) {
+      std::size_t at = this->alias_prob.size();
+      this->alias_at[it->first] = at;
+      this->alias_prob.resize(at + n);
+      this->alias_of.resize(at + n);
+      scaled.resize(n);
+      double mean = static_cast<double>(this->totals[it->first]) / n;
+      for (std::size_t j = 0; j < n; j++)
+        scaled[j] = suf[j].count / mean;
+      buildAlias(scaled, &this->alias_prob[at], &this->alias_of[at]);
+    }
+    else {
+      this->sums_at[it->first] = this->sums.size();
+      std::uint64_t sum = 0;
+      for (std::size_t j = 0; j < n; j++)
+        this->sums.push_back(sum += suf[j].count);
+    }
+  }
+}
+
+// Count each word's states, turn the counts into offsets, then place
+// the states, which leaves every list in order.
+void model::buildIndex() {
+  std::size_t nstates = this->size();
+  std::size_t len = this->prefix_len;
+  this->index_first.assign(this->vocab.size() + 1, 0);
+  for (state st = 0; st < nstates; st++) {
+    const token *pref = this->prefixOf(st);
+    for (std::size_t k = 0; k < len; k++)
+      if (std::find(pref, pref + k, pref[k]) == pref + k)
+        this->index_first[pref[k] + 1]++;
+  }
+  for (std::size_t t = 0; t < this->vocab.size(); t++)
+    this->index_first[t + 1] += this->index_first[t];
+
+  std::vector<std::size_t> next(this->index_first.begin(),
+                                this->index_first.end() - 1);
+  this->index_states.resize(this->index_first.back());
+  for (state st = 0; st < nstates; st++) {
+    const token *pref = this->prefixOf(st);
+    for (std::size_t k = 0; k < len; k++)
+      if (std::find(pref, pref + k, pref[k]) == pref + k)
+        this->index_states[next[pref[k]]++] = st;
+  }
+}
+
+bool model::frozen() const {
+  return this->is_frozen;
+}
+
+bool model::indexed() const {
+  return !this->index_first.empty();
+}
+
+std::pair<const model::state *, const model::state *>
+model::statesWith(token t) const {
+  const state *base = this->index_states.data();
+  if (t + 1 >= this->index_first.size())
+    return std::make_pair(base, base);
+  return std::make_pair(base + this->index_first[t],
+                        base + this->index_first[t + 1]);
+}
+
+std::size_t model::top(state s, std::size_t k, successor *out) const {
+  const successor_list& suf = this->suffixes[s];
+  k = std::min(k, suf.size());
+  if (this->is_frozen)
+    std::copy(suf.begin(), suf.begin() + k, out);
+  else
+    std::partial_sort_copy(suf.begin(), suf.end(), out, out + k,
+                           moreFrequent);
+  return k;
+}
+
+std::uint64_t model::total(state s) const {
+  return this->totals[s];
+}
+
+std::uint32_t model::count(state s, token t) const {
+  const successor_list& suf = this->suffixes[s];
+  std::size_t j = this->position(s, t);
+  return j < suf.size() ? suf[j].count : 0;
+}
+
+// States with many successors find t through their hash slots; the
+// rest are short enough to scan.
+std::size_t model::position(state s, token t) const {
+  const successor_list& suf = this->suffixes[s];
+  if (suf.size() > hash_fanout) {
+    const std::vector<std::uint32_t>& slots = this->suffix_slots.at(s);
+    std::size_t k = findSlot(slots, suf, t);
+    return slots[k] == empty_slot ? suf.size() : slots[k];
+  }
+  std::size_t j = 0;
+  while (j < suf.size() && suf[j].word != t)
+    j++;
+  return j;
+}
+
+double model::score(const token *ids, std::size_t n,
+                    double *logprobs) const {
+  std::size_t i;
+  for (i = 0; i < this->prefix_len && i < n; i++)
+    if (logprobs)
+      logprobs[i] = 0;
+
+  // Without per-token output, the probabilities are multiplied
+  // together and the product renormalized with frexp every few steps,
+  // so only one log is taken for the whole sequence.  Each factor is
+  // at least 2^-32, so 16 of them cannot underflow a double.
+  double mant = 1;
+  long exp2 = 0;
+  double sum = 0;
+  bool zero = false;
+  for (; i < n; i++) {
+    state st = this->find(ids + i - this->prefix_len);
+    std::uint32_t c = st == no_state ? 0 : this->count(st, ids[i]);
+    if (logprobs) {
+      double lp = c ? std::log(static_cast<double>(c) / this->totals[st])
+        : -HUGE_VAL;
+      logprobs[i] = lp;
+      sum += lp;
+      continue;
+    }
+    if (c == 0) {
+      zero = true;
+      break;
+    }
+    mant *= static_cast<double>(c) / this->totals[st];
+    if ((i & 15) == 15) {
+      int e;
+      mant = std::frexp(mant, &e);
+      exp2 += e;
+    }
+  }
+  if (logprobs)
+    return sum;
+  if (zero)
+    return -HUGE_VAL;
+  return std::log(mant) + exp2 * M_LN2;
+}
+
+void model::scoreBatch(const token *ids, const std::size_t *starts,
+                       std::size_t nseqs, double *out,
+                       unsigned threads) const {
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  if (threads > nseqs / 64 + 1)
+    threads = nseqs / 64 + 1;
+
+  // Sequences are handed out in chunks so that threads stay busy when
+  // the lengths vary.
+  const std::size_t chunk = 256;
+  std::atomic<std::size_t> cursor(0);
+  auto work = [&] {
+    std::size_t first;
+    while ((first = cursor.fetch_add(chunk)) < nseqs) {
+      std::size_t last = std::min(first + chunk, nseqs);
+      for (std::size_t k = first; k < last; k++)
+        out[k] = this->score(ids + starts[k], starts[k + 1] - starts[k]);
+    }
+  };
+  std::vector<std::thread> workers;
+  for (unsigned t = 1; t < threads; t++)
+    workers.push_back(std::thread(work));
+  work();
+  for (std::size_t t = 0; t < workers.size(); t++)
+    workers[t].join();
+}
+
+namespace {
+
+// Draws from the shared random() generator, seeding it first if need
+// be.  Numbers below 2^31 take one call, as they always have.
+struct shared_draw {
+  shared_draw() {
+    if (!chain::isSeeded())
+      chain::seed();
+  }
+  std::uint64_t operator()(std::uint64_t n) {
+    if (n <= 0x80000000)
+      return random() % n;
+    return (static_cast<std::uint64_t>(random()) << 31 | random()) % n;
+  }
+};
+
+// Draws from one stream of a counter-based generator.
+struct stream_draw {
+  philox& rng;
+  std::uint64_t operator()(std::uint64_t n) {
+    return this->rng.below(n);
+  }
+};
+
+}
+
+template <class Draw>
+model::state model::pickState(Draw& draw) const {
+  if (this->suffixes.empty())
+    return no_state;
+  return static_cast<state>(draw(this->suffixes.size()));
+}
+
+model::state model::randomState() const {
+  shared_draw draw;
+  return this->pickState(draw);
+}
+
+model::state model::randomState(philox& rng) const {
+  stream_draw draw{rng};
+  return this->pickState(draw);
+}
+
+std::size_t model::starts() const {
+  return this->start_states.size();
+}
+
+template <class Draw>
+model::state model::pickStart(Draw& draw) const {
+  if (!this->sentence_breaks || this->start_states.empty())
+    return this->pickState(draw);
+  std::size_t n = this->start_states.size();
+  if (!this->start_prob.empty()) {
+    std::size_t i = draw(n);
+    double u = draw(0x80000000) / 2147483648.0;
+    return this->start_states[u < this->start_prob[i]
+                              ? i : this->start_alias[i]];
+  }
+  std::uint64_t r = draw(this->start_total);
+  std::size_t i = 0;
+  while (r >= this->start_counts[this->start_states[i]])
+    r -= this->start_counts[this->start_states[i++]];
+  return this->start_states[i];
+}
+
+model::state model::randomStart() const {
+  shared_draw draw;
+  return this->pickStart(draw);
+}
+
+model::state model::randomStart(philox& rng) const {
+  stream_draw draw{rng};
+  return this->pickStart(draw);
+}
+
+model::state model::randomState(token t) const {
+  if (!chain::isSeeded())
+    chain::seed();
+  if (this->indexed()) {
+    std::pair<const state *, const state *> list = this->statesWith(t);
+    if (list.first == list.second)
+      return no_state;
+    return list.first[random() % (list.second - list.first)];
+  }
+
+  // Reservoir sampling over every state.
+  state found = no_state;
+  unsigned long seen = 0;
+  for (state st = 0; st < this->suffixes.size(); st++) {
+    const token *pref = this->prefixOf(st);
+    if (std::find(pref, pref + this->prefix_len, t) == pref + this->prefix_len)
+      continue;
+    if (random() % ++seen == 0)
+      found = st;
+  }
+  return found;
+}
+
+// The index of a successor of st, drawn in proportion to its count,
+// by whichever of the alias table, the running sums or a scan the
+// state has.
+template <class Draw>
+std::size_t model::pickSuccessor(state st, Draw& draw) const {
+  const successor_list& suf = this->suffixes[st];
+  if (suf.size() >= alias_fanout) {
+    std::unordered_map<state, std::size_t>::const_iterator it =
+      this->alias_at.find(st);
+    if (it != this->alias_at.end()) {
+      std::size_t i = draw(suf.size());
+      double u = draw(0x80000000) / 2147483648.0;
+      return u < this->alias_prob[it->second + i]
+        ? i : this->alias_of[it->second + i];
+    }
+  }
+  std::uint64_t r = draw(this->totals[st]);
+  if (suf.size() > hash_fanout) {
+    std::unordered_map<state, std::size_t>::const_iterator it =
+      this->sums_at.find(st);
+    if (it != this->sums_at.end()) {
+      const std::uint64_t *first = &this->sums[it->second];
+      return std::upper_bound(first, first + suf.size(), r) - first;
+    }
+  }
+  std::size_t j = 0;
+  while (r >= suf[j].count)
+    r -= suf[j++].count;
+  return j;
+}
+
+template <class Draw>
+std::size_t model::walk(token *out, std::size_t nwords, const token *pref,
+                        bool tryhard, Draw& draw) const {
+  state st = pref ? this->find(pref) : no_state;
+  if (st == no_state)
+    st = this->pickStart(draw);
+  if (st == no_state)
+    return 0;
+
+  std::vector<token> cur(this->prefixOf(st),
+                         this->prefixOf(st) + this->prefix_len);
+  std::size_t i;
+  for (i = 0; i < this->prefix_len && i < nwords; i++)
+    out[i] = cur[i];
+
+  for (; i < nwords; i++) {
+    // A state with only one successor needs no draw.
+    const successor_list& suf = this->suffixes[st];
+    token w = suf[suf.size() > 1 ? this->pickSuccessor(st, draw) : 0].word;
+    out[i] = w;
+
+    std::copy(cur.begin() + 1, cur.end(), cur.begin());
+    cur.back() = w;
+    st = this->find(cur.data());
+    if (st == no_state) {
+      if (!tryhard) {
+        i++;
+        break;
+      }
+      st = this->pickStart(draw);
+      std::copy(this->prefixOf(st), this->prefixOf(st) + this->prefix_len,
+                cur.begin());
+      // After a sentence break, the next sentence is written whole.
+      if (this->sentence_breaks)
+        for (std::size_t k = 0; k < this->prefix_len && i + 1 < nwords; k++)
+          out[++i] = cur[k];
+    }
+  }
+  return i;
+}
+
+std::size_t model::generate(token *out, std::size_t nwords,
+                            const token *pref, bool tryhard) const {
+  shared_draw draw;
+  return this->walk(out, nwords, pref, tryhard, draw);
+}
+
+std::size_t model::generate(token *out, std::size_t nwords,
+                            const token *pref, bool tryhard,
+                            philox& rng) const {
+  stream_draw draw{rng};
+  return this->walk(out, nwords, pref, tryhard, draw);
+}
+
+void model::generateBatch(std::uint64_t seed, std::size_t count,
+                          std::size_t nwords, token *out,
+                          std::size_t *lengths, bool tryhard,
+                          unsigned threads, const token *pref,
+                          std::uint64_t first) const {
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  if (threads > count / 64 + 1)
+    threads = count / 64 + 1;
+
+  // Sample k always draws from stream first + k, whichever thread
+  // takes it.
+  const std::size_t chunk = 64;
+  std::atomic<std::size_t> cursor(0);
+  auto work = [&] {
+    philox rng;
+    std::size_t lo;
+    while ((lo = cursor.fetch_add(chunk)) < count) {
+      std::size_t hi = std::min(lo + chunk, count);
+      for (std::size_t k = lo; k < hi; k++) {
+        rng.seed(seed, first + k);
+        lengths[k] = this->generate(out + k * nwords, nwords, pref, tryhard,
+                                    rng);
+      }
+    }
+  };
+  std::vector<std::thread> workers;
+  for (unsigned t = 1; t < threads; t++)
+    workers.push_back(std::thread(work));
+  work();
+  for (std::size_t t = 0; t < workers.size(); t++)
+    workers[t].join();
+}
+
+std::size_t model::generate(std::vector<token>& out, std::size_t nwords,
+                            const token *pref, bool tryhard) const {
+  std::size_t start = out.size();
+  out.resize(start + nwords);
+  std::size_t n = this->generate(out.data() + start, nwords, pref, tryhard);
+  out.resize(start + n);
+  return n;
+}
+
+void model::write(std::ostream& s) const {
+  for (state st = 0; st < this->suffixes.size(); st++) {
+    const token *pref = this->prefixOf(st);
+    for (std::size_t i = 0; i < this->prefix_len; i++)
+      s << this->vocab.word(pref[i]) << ' ';
+    s << ':';
+    const successor_list& suf = this->suffixes[st];
+    for (successor_list::const_iterator it = suf.begin(); it != suf.end();
+         it++)
+      for (std::uint32_t n = 0; n < it->count; n++)
+        s << ' ' << this->vocab.word(it->word);
+    s << '\n';
+  }
+  if (!this->sentence_breaks)
+    return;
+  for (std::size_t i = 0; i < this->start_states.size(); i++) {
+    state st = this->start_states[i];
+    const token *pref = this->prefixOf(st);
+    for (std::size_t k = 0; k < this->prefix_len; k++)
+      s << this->vocab.word(pref[k]) << ' ';
+    s << "^ " << this->start_counts[st] << '\n';
+  }
+}
+
+// A start line is a prefix, a caret and the number of times the
+// prefix started a sentence or document.  It has no " : " outside the
+// prefix, so chain::read passes over it; and where a transition line
+// has a colon after prefixLength() words, a start line has the caret.
+bool model::readStart(std::string_view line) {
+  std::size_t caret = line.rfind(" ^ ");
+  if (caret == std::string_view::npos
+      || static_cast<std::size_t>(std::count(line.begin(),
+                                             line.begin() + caret, ' '))
+           + 1 != this->prefix_len)
+    return false;
+  std::string_view num = line.substr(caret + 3);
+  if (num.empty() || num.find_first_not_of("0123456789")
+                       != std::string_view::npos)
+    return false;
+
+  std::vector<token> pref;
+  std::string_view ptext = line.substr(0, caret);
+  std::size_t spos;
+  do {
+    spos = ptext.find(' ');
+    pref.push_back(this->vocab.find(ptext.substr(0, spos)));
+    if (spos != std::string_view::npos)
+      ptext.remove_prefix(spos + 1);
+  } while (spos != std::string_view::npos);
+  if (std::find(pref.begin(), pref.end(), no_token) != pref.end())
+    return true;
+  state st = this->find(pref.data());
+  std::uint32_t n = std::strtoul(std::string(num).c_str(), NULL, 10);
+  if (st == no_state || n == 0)
+    return true;
+  if (this->start_counts[st] == 0)
+    this->start_states.push_back(st);
+  this->start_counts[st] += n;
+  this->start_total += n;
+  this->sentence_breaks = true;
+  return true;
+}
+
+void model::read(std::istream& s) {
+  std::size_t len = 0;
+  this->clear();
+  std::vector<token> pref;
+  std::string line;
+  while (std::getline(s, line)) {
+    if (len > 0 && this->readStart(line))
+      continue;
+    std::size_t cpos = line.find(" : ");
+    if (cpos == std::string::npos)
+      continue;
+    std::string_view text(line);
+    pref.clear();
+    std::string_view ptext = text.substr(0, cpos);
+    std::size_t spos;
+    do {
+      spos = ptext.find(' ');
+      pref.push_back(this->vocab.intern(ptext.substr(0, spos)));
+      if (spos != std::string_view::npos)
+        ptext.remove_prefix(spos + 1);
+    } while (spos != std::string_view::npos);
+
+    if (len == 0) {
+      len = pref.size();
+      this->prefix_len = len;
+      this->table = prefix_table(len);
+      this->window.reserve(len);
+    }
+    if (pref.size() != len)
+      continue;
+
+    state st = this->intern(pref.data());
+    std::string_view stext = text.substr(cpos + 3);
+    do {
+      spos = stext.find(' ');
+      this->record(st, this->vocab.intern(stext.substr(0, spos)), 1);
+      if (spos != std::string_view::npos)
+        stext.remove_prefix(spos + 1);
+    } while (spos != std::string_view::npos);
+  }
+}
+
+model model::reduce() const {
+  if (this->prefix_len == 1)
+    return *this;
+  model m(this->prefix_len - 1);
+  m.vocab = this->vocab;
+  for (state st = 0; st < this->suffixes.size(); st++) {
+    state to = m.intern(this->prefixOf(st) + 1);
+    const successor_list& suf = this->suffixes[st];
+    for (std::size_t j = 0; j < suf.size(); j++)
+      m.record(to, suf[j].word, suf[j].count);
+  }
+  return m;
+}
+
+}
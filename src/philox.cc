@@ -0,0 +1,149 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <config.h>
+#include <philox.hh>
+
+#include <algorithm>
+
+namespace markov {
+
+namespace {
+
+const std::uint32_t mul0 = 0xD2511F53;
+const std::uint32_t mul1 = 0xCD9E8D57;
+const std::uint32_t weyl0 = 0x9E3779B9;
+const std::uint32_t weyl1 = 0xBB67AE85;
+const int rounds = 10;
+
+}
+
+philox::philox(std::uint64_t key, std::uint64_t stream) {
+  this->seed(key, stream);
+}
+
+void philox::seed(std::uint64_t key, std::uint64_t stream) {
+  this->k[0] = static_cast<std::uint32_t>(key);
+  this->k[1] = static_cast<std::uint32_t>(key >> 32);
+  this->counter = 0;
+  this->stream_id = stream;
+  this->pos = buffered;
+}
+
+void philox::block(const std::uint32_t ctr[4], const std::uint32_t key[2],
+                   std::uint32_t out[4]) {
+  std::uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+  std::uint32_t k0 = key[0], k1 = key[1];
+  for (int r = 0; r < rounds; r++) {
+    std::uint64_t p0 = static_cast<std::uint64_t>(mul0) * c0;
+    std::uint64_t p1 = static_cast<std::uint64_t>(mul1) * c2;
+    c0 = static_cast<std::uint32_t>(p1 >> 32) ^ c1 ^ k0;
+    c1 = static_cast<std::uint32_t>(p1);
+    c2 = static_cast<std::uint32_t>(p0 >> 32) ^ c3 ^ k1;
+    c3 = static_cast<std::uint32_t>(p0);
+    k0 += weyl0;
+    k1 += weyl1;
+  }
+  out[0] = c0;
+  out[1] = c1;
+  out[2] = c2;
+  out[3] = c3;
+}
+
+// Compute n blocks from the current counter on, lanes at a time.  The
+// rounds run over arrays, one element per block, so that each step is
+// the same operation on every lane.
+void philox::blocks(std::uint32_t *out, std::size_t n) {
+  std::uint32_t s0 = static_cast<std::uint32_t>(this->stream_id);
+  std::uint32_t s1 = static_cast<std::uint32_t>(this->stream_id >> 32);
+  std::size_t b = 0;
+  for (; b + lanes <= n; b += lanes) {
+    std::uint32_t c0[lanes], c1[lanes], c2[lanes], c3[lanes];
+    for (unsigned l = 0; l < lanes; l++) {
+      std::uint64_t c = this->counter + l;
+      c0[l] = static_cast<std::uint32_t>(c);
+      c1[l] = static_cast<std::uint32_t>(c >> 32);
+      c2[l] = s0;
+      c3[l] = s1;
+    }
+    std::uint32_t k0 = this->k[0], k1 = this->k[1];
+    for (int r = 0; r < rounds; r++) {
+      for (unsigned l = 0; l < lanes; l++) {
+        std::uint64_t p0 = static_cast<std::uint64_t>(mul0) * c0[l];
+        std::uint64_t p1 = static_cast<std::uint64_t>(mul1) * c2[l];
+        c0[l] = static_cast<std::uint32_t>(p1 >> 32) ^ c1[l] ^ k0;
+        c1[l] = static_cast<std::uint32_t>(p1);
+        c2[l] = static_cast<std::uint32_t>(p0 >> 32) ^ c3[l] ^ k1;
+        c3[l] = static_cast<std::uint32_t>(p0);
+      }
+      k0 += weyl0;
+      k1 += weyl1;
+    }
+    for (unsigned l = 0; l < lanes; l++) {
+      out[4 * (b + l)] = c0[l];
+      out[4 * (b + l) + 1] = c1[l];
+      out[4 * (b + l) + 2] = c2[l];
+      out[4 * (b + l) + 3] = c3[l];
+    }
+    this->counter += lanes;
+  }
+  for (; b < n; b++) {
+    std::uint32_t ctr[4] = {
+      static_cast<std::uint32_t>(this->counter),
+      static_cast<std::uint32_t>(this->counter >> 32), s0, s1
+    };
+    block(ctr, this->k, out + 4 * b);
+    this->counter++;
+  }
+}
+
+void philox::refill() {
+  this->blocks(this->buf, lanes);
+  this->pos = 0;
+}
+
+void philox::generate(std::uint32_t *out, std::size_t n) {
+  // Use up what is buffered, then write whole blocks straight out.
+  while (n > 0 && this->pos < buffered) {
+    *out++ = this->buf[this->pos++];
+    n--;
+  }
+  std::size_t whole = n / 4;
+  this->blocks(out, whole);
+  out += 4 * whole;
+  n -= 4 * whole;
+  if (n > 0) {
+    this->refill();
+    std::copy(this->buf, this->buf + n, out);
+    this->pos = n;
+  }
+}
+
+std::uint64_t philox::below(std::uint64_t n) {
+  std::uint64_t r = this->next64();
+  // The high half of r * n, from 32-bit pieces.
+  std::uint64_t rl = r & 0xffffffff, rh = r >> 32;
+  std::uint64_t nl = n & 0xffffffff, nh = n >> 32;
+  std::uint64_t ll = rl * nl;
+  std::uint64_t lh = rl * nh;
+  std::uint64_t hl = rh * nl;
+  std::uint64_t mid = (ll >> 32) + (lh & 0xffffffff) + (hl & 0xffffffff);
+  return rh * nh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+}
+
+}
@@ -0,0 +1,307 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <config.h>
+#include <predict.hh>
+#include "words.hh"
+
+#include <algorithm>
+#include <iterator>
+
+namespace markov {
+
+prediction_cache::prediction_cache(const model& mod, std::size_t topk,
+                                   std::size_t cap) :
+  m(mod), k(topk), capacity(cap ? cap : 1), scratch(topk), nhits(0),
+  nmisses(0) {
+  this->index.reserve(this->capacity);
+}
+
+// The span of text from the start of the last prefixLength() words to
+// the end of the last one, or an empty view if there are fewer words.
+std::string_view prediction_cache::lastWords(std::string_view text) const {
+  std::size_t end = text.size();
+  while (end > 0 && isSpace(text[end - 1]))
+    end--;
+  std::size_t start = end;
+  for (std::size_t n = 0; n < this->m.prefixLength(); n++) {
+    if (n > 0)
+      while (start > 0 && isSpace(text[start - 1]))
+        start--;
+    if (start == 0)
+      return std::string_view();
+    while (start > 0 && !isSpace(text[start - 1]))
+      start--;
+  }
+  return text.substr(start, end - start);
+}
+
+void prediction_cache::compute(std::string_view words,
+                               std::vector<prediction>& out) {
+  out.clear();
+  const vocabulary& vocab = this->m.words();
+  std::vector<token> pref;
+  std::size_t pos = 0;
+  while (pos < words.size()) {
+    while (pos < words.size() && isSpace(words[pos]))
+      pos++;
+    std::size_t end = pos;
+    while (end < words.size() && !isSpace(words[end]))
+      end++;
+    token t = vocab.find(words.substr(pos, end - pos));
+    if (t == no_token)
+      return;
+    pref.push_back(t);
+    pos = end;
+  }
+
+  model::state st = this->m.find(pref.data());
+  if (st == model::no_state)
+    return;
+  std::size_t n = this->m.top(st, this->k, this->scratch.data());
+  double total = static_cast<double>(this->m.total(st));
+  for (std::size_t i = 0; i < n; i++) {
+    prediction p;
+    p.word = vocab.word(this->scratch[i].word);
+    p.id = this->scratch[i].word;
+    p.probability = this->scratch[i].count / total;
+    out.push_back(p);
+  }
+}
+
+const std::vector<prediction>&
+prediction_cache::predict(std::string_view text) {
+  static const std::vector<prediction> none;
+  std::string_view key = this->lastWords(text);
+  if (key.empty())
+    return none;
+
+  auto found = this->index.find(key);
+  if (found != this->index.end()) {
+    this->nhits++;
+    this->recent.splice(this->recent.begin(), this->recent, found->second);
+    return found->second->result;
+  }
+
+  this->nmisses++;
+  if (this->recent.size() == this->capacity) {
+    // Reuse the least recently used entry.
+    this->index.erase(this->recent.back().key);
+    this->recent.splice(this->recent.begin(), this->recent,
+                        std::prev(this->recent.end()));
+  }
+  else
+    this->recent.push_front(entry());
+  entry& e = this->recent.front();
+  e.key.assign(key.data(), key.size());
+  this->compute(e.key, e.result);
+  this->index[e.key] = this->recent.begin();
+  return e.result;
+}
+
+unsigned long long prediction_cache::hits() const {
+  return this->nhits;
+}
+
+unsigned long long prediction_cache::misses() const {
+  return this->nmisses;
+}
+
+completion_index::completion_index(const model& mod) : m(mod), nwords(0) {
+  const vocabulary& vocab = mod.words();
+  this->by_text.resize(vocab.size());
+  for (std::size_t i = 0; i < this->by_text.size(); i++)
+    this->by_text[i] = static_cast<token>(i);
+  std::sort(this->by_text.begin(), this->by_text.end(),
+            [&vocab](token a, token b) {
+              return vocab.word(a) < vocab.word(b);
+            });
+
+  this->frequency.assign(vocab.size(), 0);
+  for (model::state st = 0; st < mod.size(); st++) {
+    const model::successor_list& suf = mod.successors(st);
+    for (std::size_t j = 0; j < suf.size(); j++)
+      this->frequency[suf[j].word] += suf[j].count;
+    this->nwords += mod.total(st);
+  }
+
+  // A tree of range maximums over the sorted words, stored the usual
+  // way: leaves at size() and up, parents at half their index.
+  std::size_t n = this->by_text.size();
+  this->tree.resize(2 * n);
+  for (std::size_t i = 0; i < n; i++)
+    this->tree[n + i] = i;
+  for (std::size_t i = n; i-- > 1; )
+    this->tree[i] = this->better(this->tree[2 * i], this->tree[2 * i + 1])
+      ? this->tree[2 * i] : this->tree[2 * i + 1];
+}
+
+// Whether the word at sorted index a ranks before the one at b.
+bool completion_index::better(std::size_t a, std::size_t b) const {
+  token ta = this->by_text[a];
+  token tb = this->by_text[b];
+  return this->frequency[ta] > this->frequency[tb]
+    || (this->frequency[ta] == this->frequency[tb] && ta < tb);
+}
+
+// The sorted index of the most frequent word in [lo, hi), which must
+// not be empty.
+std::size_t completion_index::best(std::size_t lo, std::size_t hi) const {
+  std::size_t n = this->by_text.size();
+  std::size_t res = lo;
+  for (lo += n, hi += n; lo < hi; lo >>= 1, hi >>= 1) {
+    if (lo & 1) {
+      if (this->better(this->tree[lo], res))
+        res = this->tree[lo];
+      lo++;
+    }
+    if (hi & 1) {
+      hi--;
+      if (this->better(this->tree[hi], res))
+        res = this->tree[hi];
+    }
+  }
+  return res;
+}
+
+std::pair<std::size_t, std::size_t>
+completion_index::range(std::string_view partial) const {
+  const vocabulary& vocab = this->m.words();
+  std::vector<token>::const_iterator lo =
+    std::lower_bound(this->by_text.begin(), this->by_text.end(), partial,
+                     [&vocab](token a, std::string_view p) {
+                       return vocab.word(a) < p;
+                     });
+  std::vector<token>::const_iterator hi =
+    std::upper_bound(lo, this->by_text.end(), partial,
+                     [&vocab](std::string_view p, token a) {
+                       return p < vocab.word(a).substr(0, p.size());
+                     });
+  return std::make_pair(lo - this->by_text.begin(),
+                        hi - this->by_text.begin());
+}
+
+const std::vector<token>& completion_index::sorted() const {
+  return this->by_text;
+}
+
+void completion_index::complete(std::string_view text, std::size_t k,
+                                std::vector<prediction>& out) const {
+  out.clear();
+  if (k == 0)
+    return;
+  const vocabulary& vocab = this->m.words();
+
+  // Split off the partial word, then find the complete words before it.
+  std::size_t end = text.size();
+  std::size_t start = end;
+  while (start > 0 && !isSpace(text[start - 1]))
+    start--;
+  std::string_view partial = text.substr(start);
+
+  std::size_t len = this->m.prefixLength();
+  std::vector<token> pref(len, no_token);
+  std::size_t pos = start;
+  std::size_t n;
+  for (n = 0; n < len; n++) {
+    while (pos > 0 && isSpace(text[pos - 1]))
+      pos--;
+    if (pos == 0)
+      break;
+    std::size_t wend = pos;
+    while (pos > 0 && !isSpace(text[pos - 1]))
+      pos--;
+    pref[len - 1 - n] = vocab.find(text.substr(pos, wend - pos));
+  }
+
+  model::state st = n == len ? this->m.find(pref.data()) : model::no_state;
+  if (st != model::no_state) {
+    const model::successor_list& suf = this->m.successors(st);
+    double total = static_cast<double>(this->m.total(st));
+    std::vector<model::successor> found;
+    for (std::size_t j = 0; j < suf.size(); j++) {
+      if (vocab.word(suf[j].word).substr(0, partial.size()) != partial)
+        continue;
+      found.push_back(suf[j]);
+      if (this->m.frozen() && found.size() == k)
+        break;
+    }
+    if (!this->m.frozen()) {
+      std::size_t keep = std::min(k, found.size());
+      std::partial_sort(found.begin(), found.begin() + keep, found.end(),
+                        [](const model::successor& a,
+                           const model::successor& b) {
+                          return a.count > b.count
+                            || (a.count == b.count && a.word < b.word);
+                        });
+      found.resize(keep);
+    }
+    for (std::size_t j = 0; j < found.size(); j++) {
+      prediction p;
+      p.word = vocab.word(found[j].word);
+      p.id = found[j].word;
+      p.probability = found[j].count / total;
+      out.push_back(p);
+    }
+  }
+  if (out.size() == k)
+    return;
+
+  // Take the most frequent words of the range one at a time: the best
+  // word of a range splits it in two, and the best of each half is
+  // found in the tree.
+  std::pair<std::size_t, std::size_t> r = this->range(partial);
+  struct span {
+    std::size_t best, lo, hi;
+  };
+  auto worse = [this](const span& a, const span& b) {
+    return this->better(b.best, a.best);
+  };
+  std::vector<span> heap;
+  if (r.first < r.second)
+    heap.push_back(span{this->best(r.first, r.second), r.first, r.second});
+  while (!heap.empty() && out.size() < k) {
+    std::pop_heap(heap.begin(), heap.end(), worse);
+    span sp = heap.back();
+    heap.pop_back();
+    if (sp.lo < sp.best) {
+      heap.push_back(span{this->best(sp.lo, sp.best), sp.lo, sp.best});
+      std::push_heap(heap.begin(), heap.end(), worse);
+    }
+    if (sp.best + 1 < sp.hi) {
+      heap.push_back(span{this->best(sp.best + 1, sp.hi), sp.best + 1,
+                          sp.hi});
+      std::push_heap(heap.begin(), heap.end(), worse);
+    }
+
+    token t = this->by_text[sp.best];
+    bool dup = false;
+    for (std::size_t j = 0; j < out.size() && !dup; j++)
+      dup = out[j].id == t;
+    if (dup)
+      continue;
+    prediction p;
+    p.word = vocab.word(t);
+    p.id = t;
+    p.probability = this->nwords
+      ? static_cast<double>(this->frequency[t]) / this->nwords : 0;
+    out.push_back(p);
+  }
+}
+
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <config.h>
+#include <prefixes.hh>
+
+#include <cstring>
+
+namespace markov {
+
+static inline std::uint64_t hashPrefix(const token *p, std::size_t n)
+{
+  std::uint64_t h = 0x9e3779b97f4a7c15ULL;
+  for (std::size_t i = 0; i < n; i++) {
+    h = (h ^ p[i]) * 0xff51afd7ed558ccdULL;
+    h ^= h >> 32;
+  }
+  return h;
+}
+
+prefix_table::prefix_table(std::size_t len) :
+  prefix_len(len ? len : 1), slots(16, no_state) {}
+
+// Find the slot holding pref, or the empty slot where it belongs.
+std::size_t prefix_table::probe(const token *pref) const {
+  std::size_t mask = this->slots.size() - 1;
+  std::size_t i = hashPrefix(pref, this->prefix_len) & mask;
+  while (this->slots[i] != no_state
+         && std::memcmp(this->prefixOf(this->slots[i]), pref,
+                        this->prefix_len * sizeof(token)) != 0)
+    i = (i + 1) & mask;
+  return i;
+}
+
+void prefix_table::grow() {
+  std::vector<state> old(this->slots.size() * 2, no_state);
+  old.swap(this->slots);
+  std::size_t mask = this->slots.size() - 1;
+  for (std::size_t j = 0; j < old.size(); j++) {
+    if (old[j] == no_state)
+      continue;
+    std::size_t i = hashPrefix(this->prefixOf(old[j]), this->prefix_len)
+      & mask;
+    while (this->slots[i] != no_state)
+      i = (i + 1) & mask;
+    this->slots[i] = old[j];
+  }
+}
+
+prefix_table::state prefix_table::find(const token *pref) const {
+  return this->slots[this->probe(pref)];
+}
+
+prefix_table::state prefix_table::intern(const token *pref) {
+  std::size_t i = this->probe(pref);
+  if (this->slots[i] != no_state)
+    return this->slots[i];
+
+  state s = static_cast<state>(this->size());
+  this->keys.insert(this->keys.end(), pref, pref + this->prefix_len);
+  this->slots[i] = s;
+  if (2 * this->size() > this->slots.size())
+    this->grow();
+  return s;
+}
+
+void prefix_table::clear() {
+  this->keys.clear();
+  this->slots.assign(16, no_state);
+}
+
+}
@@ -0,0 +1,311 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <config.h>
+#include <chain.hh>
+#include <constraints.hh>
+#include <sampler.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace markov {
+
+namespace {
+
+// A uniform double in [0, 1) from two calls to random().
+double uniform() {
+  std::uint64_t r = (static_cast<std::uint64_t>(random()) << 31) | random();
+  return std::ldexp(static_cast<double>(r), -62);
+}
+
+}
+
+sampler::sampler(const model& mod) : m(mod), sums(NULL), temp(1.0),
+                                     top_p(1.0) {
+  std::size_t n = 0;
+  for (model::state st = 0; st < mod.size(); st++)
+    n += mod.successors(st).size();
+
+  // The weights at temperature one are the counts themselves; those
+  // for other temperatures are worked out from them.
+  this->offsets.reserve(mod.size() + 1);
+  this->order.reserve(n);
+  std::vector<double>& ones = this->tables[1.0];
+  ones.reserve(n);
+  std::vector<model::successor> suf;
+  for (model::state st = 0; st < mod.size(); st++) {
+    this->offsets.push_back(this->order.size());
+    const model::successor_list& list = mod.successors(st);
+    suf.assign(list.begin(), list.end());
+    if (!mod.frozen())
+      std::sort(suf.begin(), suf.end(),
+                [](const model::successor& a, const model::successor& b) {
+                  return a.count > b.count
+                    || (a.count == b.count && a.word < b.word);
+                });
+    double sum = 0;
+    for (std::size_t j = 0; j < suf.size(); j++) {
+      this->order.push_back(suf[j].word);
+      sum += suf[j].count;
+      ones.push_back(sum);
+    }
+  }
+  this->offsets.push_back(this->order.size());
+  this->sums = &ones;
+}
+
+void sampler::setTemperature(double t) {
+  if (t < 0)
+    t = 0;
+  this->temp = t;
+  if (t == 0)
+    return;
+
+  std::vector<double>& table = this->tables[t];
+  this->sums = &table;
+  if (!table.empty() || this->order.empty())
+    return;
+
+  // Each weight is taken relative to the state's most frequent word,
+  // which keeps low temperatures from overflowing.
+  const std::vector<double>& ones = this->tables[1.0];
+  table.resize(ones.size());
+  double power = 1.0 / t;
+  for (std::size_t s = 0; s + 1 < this->offsets.size(); s++) {
+    std::size_t lo = this->offsets[s];
+    std::size_t hi = this->offsets[s + 1];
+    if (lo == hi)
+      continue;
+    double most = ones[lo];
+    double sum = 0;
+    for (std::size_t j = lo; j < hi; j++) {
+      double count = j > lo ? ones[j] - ones[j - 1] : ones[j];
+      sum += std::pow(count / most, power);
+      table[j] = sum;
+    }
+  }
+}
+
+double sampler::temperature() const {
+  return this->temp;
+}
+
+void sampler::setTopP(double p) {
+  this->top_p = p > 0 && p < 1 ? p : 1.0;
+}
+
+double sampler::topP() const {
+  return this->top_p;
+}
+
+void sampler::clear() {
+  std::map<double, std::vector<double> >::iterator it = this->tables.begin();
+  while (it != this->tables.end()) {
+    if (it->first == 1.0 || &it->second == this->sums)
+      it++;
+    else
+      it = this->tables.erase(it);
+  }
+}
+
+// The index of the last word of [lo, hi) inside the top-p cut.
+std::size_t sampler::cut(std::size_t lo, std::size_t hi) const {
+  const double *sum = this->sums->data();
+  std::size_t last = hi - 1;
+  if (this->top_p < 1)
+    last = std::lower_bound(sum + lo, sum + last, this->top_p * sum[last])
+      - sum;
+  return last;
+}
+
+token sampler::next(model::state s) const {
+  std::size_t lo = this->offsets[s];
+  std::size_t hi = this->offsets[s + 1];
+  if (this->temp == 0 || hi - lo == 1)
+    return this->order[lo];
+  if (!chain::isSeeded())
+    chain::seed();
+
+  const double *sum = this->sums->data();
+  std::size_t last = this->cut(lo, hi);
+  double r = uniform() * sum[last];
+  std::size_t j = std::upper_bound(sum + lo, sum + last, r) - sum;
+  return this->order[j];
+}
+
+std::size_t sampler::generate(token *out, std::size_t nwords,
+                              const token *pref, bool tryhard) const {
+  model::state st = pref ? this->m.find(pref) : model::no_state;
+  if (st == model::no_state)
+    st = this->m.randomStart();
+  if (st == model::no_state)
+    return 0;
+
+  std::size_t len = this->m.prefixLength();
+  std::vector<token> cur(this->m.prefixOf(st), this->m.prefixOf(st) + len);
+  std::size_t i;
+  for (i = 0; i < len && i < nwords; i++)
+    out[i] = cur[i];
+
+  for (; i < nwords; i++) {
+    token w = this->next(st);
+    out[i] = w;
+
+    std::copy(cur.begin() + 1, cur.end(), cur.begin());
+    cur.back() = w;
+    st = this->m.find(cur.data());
+    if (st == model::no_state) {
+      if (!tryhard) {
+        i++;
+        break;
+      }
+      st = this->m.randomStart();
+      std::copy(this->m.prefixOf(st), this->m.prefixOf(st) + len,
+                cur.begin());
+      // After a sentence break, the next sentence is written whole.
+      if (this->m.sentenceBreaks())
+        for (std::size_t k = 0; k < len && i + 1 < nwords; k++)
+          out[++i] = cur[k];
+    }
+  }
+  return i;
+}
+
+// Whether w may be generated with left words to go, counting w.  next
+// holds the prefix the walk is at, shifted one to the left.
+bool sampler::allowed(token w, token *next, const word_set *banned,
+                      const endings *ends, std::size_t left) const {
+  if (banned && banned->contains(w))
+    return false;
+  if (!ends || ends->terminal(w))
+    return true;
+  next[this->m.prefixLength() - 1] = w;
+  return ends->distance(this->m.find(next)) < left;
+}
+
+// An allowed word to follow s, or no_token if there is none.
+token sampler::choose(model::state s, token *next, const word_set *banned,
+                      const endings *ends, std::size_t left) const {
+  // A few draws usually find an allowed word, at the usual cost.
+  if (this->temp > 0)
+    for (int tries = 0; tries < 8; tries++) {
+      token w = this->next(s);
+      if (this->allowed(w, next, banned, ends, left))
+        return w;
+    }
+
+  // Otherwise weigh the allowed words inside the cut, or failing
+  // that all of them, and draw from those.
+  std::size_t lo = this->offsets[s];
+  std::size_t hi = this->offsets[s + 1];
+  std::size_t last = this->cut(lo, hi);
+  const double *sum = this->sums->data();
+  std::vector<std::pair<double, token> > ok;
+  for (int pass = 0; pass < 2 && ok.empty(); pass++) {
+    std::size_t first = pass ? last + 1 : lo;
+    std::size_t end = pass ? hi : last + 1;
+    double total = 0;
+    for (std::size_t j = first; j < end; j++) {
+      if (!this->allowed(this->order[j], next, banned, ends, left))
+        continue;
+      if (this->temp == 0)
+        return this->order[j];
+      total += j > lo ? sum[j] - sum[j - 1] : sum[j];
+      ok.push_back(std::make_pair(total, this->order[j]));
+    }
+  }
+  if (ok.empty())
+    return no_token;
+  double r = uniform() * ok.back().first;
+  std::size_t j = 0;
+  while (j + 1 < ok.size() && r >= ok[j].first)
+    j++;
+  return ok[j].second;
+}
+
+// A random start whose prefix is not banned and, given endings, from
+// which a terminal word can be reached in left words, or no_state.
+model::state sampler::start(std::size_t left, const word_set *banned,
+                            const endings *ends) const {
+  std::size_t len = this->m.prefixLength();
+  for (int tries = 0; tries < 64; tries++) {
+    model::state s = this->m.randomStart();
+    if (s == model::no_state)
+      break;
+    const token *words = this->m.prefixOf(s);
+    bool ok = !ends || ends->distance(s) <= left;
+    for (std::size_t k = 0; k < len && ok && banned; k++)
+      ok = !banned->contains(words[k]);
+    if (ok)
+      return s;
+  }
+  return model::no_state;
+}
+
+std::size_t sampler::generate(token *out, std::size_t nwords,
+                              const token *pref, const word_set *banned,
+                              const endings *ends, bool tryhard) const {
+  std::size_t len = this->m.prefixLength();
+  model::state st = pref ? this->m.find(pref) : model::no_state;
+  if (st == model::no_state)
+    st = this->start(nwords - std::min(nwords, len), banned, ends);
+  if (st == model::no_state)
+    return 0;
+
+  std::vector<token> next(this->m.prefixOf(st) + 1,
+                          this->m.prefixOf(st) + len);
+  next.push_back(no_token);
+  std::size_t i;
+  for (i = 0; i < len && i < nwords; i++)
+    out[i] = this->m.prefixOf(st)[i];
+
+  for (; i < nwords; i++) {
+    token w = this->choose(st, next.data(), banned, ends, nwords - i);
+    if (w == no_token)
+      break;
+    out[i] = w;
+    if (ends && ends->terminal(w))
+      return i + 1;
+    next.back() = w;
+    st = this->m.find(next.data());
+    if (st == model::no_state) {
+      if (!tryhard)
+        return i + 1;
+      // Start again as generate() does, writing the new prefix out
+      // after a sentence break.
+      bool whole = this->m.sentenceBreaks();
+      std::size_t left = nwords - i - 1;
+      st = this->start(whole ? left - std::min(left, len) : left, banned,
+                       ends);
+      if (st == model::no_state)
+        return i + 1;
+      const token *words = this->m.prefixOf(st);
+      if (whole)
+        for (std::size_t k = 0; k < len && i + 1 < nwords; k++)
+          out[++i] = words[k];
+      std::copy(words + 1, words + len, next.begin());
+      continue;
+    }
+    std::copy(next.begin() + 1, next.end(), next.begin());
+  }
+  return i;
+}
+
+}
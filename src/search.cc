@@ -0,0 +1,185 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <config.h>
+#include <search.hh>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+namespace markov {
+
+namespace {
+
+const std::size_t no_parent = static_cast<std::size_t>(-1);
+
+}
+
+beam_search::beam_search(const model& mod, std::size_t beam,
+                         std::size_t nwords) :
+  m(mod), width(beam ? beam : 1), length(nwords),
+  steps(this->width * nwords), counts(nwords, 0),
+  next(mod.prefixLength()) {
+  this->candidates.reserve(this->width);
+}
+
+std::size_t beam_search::run(const token *pref, token *out,
+                             double *logprob) {
+  hypothesis root;
+  root.st = this->m.find(pref);
+  root.score = 0;
+  root.parent = no_parent;
+  root.word = no_token;
+  if (root.st == model::no_state) {
+    if (logprob)
+      *logprob = -HUGE_VAL;
+    return 0;
+  }
+
+  // The candidates form a heap with the least likely on top, so that
+  // one more likely than the worst kept replaces it.
+  auto worse = [](const hypothesis& a, const hypothesis& b) {
+    return a.score > b.score;
+  };
+  std::size_t len = this->m.prefixLength();
+  std::size_t t;
+  for (t = 0; t < this->length; t++) {
+    const hypothesis *prev = t ? &this->steps[(t - 1) * this->width] : &root;
+    std::size_t nprev = t ? this->counts[t - 1] : 1;
+    bool last = t + 1 == this->length;
+    this->candidates.clear();
+
+    for (std::size_t i = 0; i < nprev; i++) {
+      const hypothesis& h = prev[i];
+      const model::successor_list& suf = this->m.successors(h.st);
+      std::uint64_t total = this->m.total(h.st);
+      if (total == 0)
+        continue;
+      double base = h.score - std::log(static_cast<double>(total));
+      const token *words = this->m.prefixOf(h.st);
+      std::copy(words + 1, words + len, this->next.begin());
+
+      for (std::size_t j = 0; j < suf.size(); j++) {
+        double score = base + std::log(static_cast<double>(suf[j].count));
+        bool full = this->candidates.size() == this->width;
+        if (full && score <= this->candidates.front().score) {
+          // The rest of a frozen list are no more frequent.
+          if (this->m.frozen())
+            break;
+          continue;
+        }
+
+        this->next[len - 1] = suf[j].word;
+        model::state ns = this->m.find(this->next.data());
+        if (ns == model::no_state && !last)
+          continue;
+
+        // Keep only the better of two sequences reaching one state.
+        std::size_t k = this->candidates.size();
+        if (ns != model::no_state)
+          for (k = 0; k < this->candidates.size(); k++)
+            if (this->candidates[k].st == ns)
+              break;
+        hypothesis c;
+        c.st = ns;
+        c.score = score;
+        c.parent = i;
+        c.word = suf[j].word;
+        if (k < this->candidates.size()) {
+          if (this->candidates[k].score < score) {
+            this->candidates[k] = c;
+            std::make_heap(this->candidates.begin(), this->candidates.end(),
+                           worse);
+          }
+        }
+        else if (full) {
+          std::pop_heap(this->candidates.begin(), this->candidates.end(),
+                        worse);
+          this->candidates.back() = c;
+          std::push_heap(this->candidates.begin(), this->candidates.end(),
+                         worse);
+        }
+        else {
+          this->candidates.push_back(c);
+          std::push_heap(this->candidates.begin(), this->candidates.end(),
+                         worse);
+        }
+      }
+    }
+
+    if (this->candidates.empty())
+      break;
+    std::copy(this->candidates.begin(), this->candidates.end(),
+              this->steps.begin() + t * this->width);
+    this->counts[t] = this->candidates.size();
+  }
+
+  if (t == 0) {
+    if (logprob)
+      *logprob = 0;
+    return 0;
+  }
+
+  // Follow the best sequence of the last step back to the start.
+  const hypothesis *step = &this->steps[(t - 1) * this->width];
+  std::size_t best = 0;
+  for (std::size_t i = 1; i < this->counts[t - 1]; i++)
+    if (step[i].score > step[best].score)
+      best = i;
+  if (logprob)
+    *logprob = step[best].score;
+  for (std::size_t i = t; i-- > 0; ) {
+    const hypothesis& h = this->steps[i * this->width + best];
+    out[i] = h.word;
+    best = h.parent;
+  }
+  return t;
+}
+
+void beamSearch(const model& m, std::size_t width, std::size_t length,
+                const token *seeds, std::size_t nseeds, token *out,
+                std::size_t *lengths, double *logprobs, unsigned threads) {
+  const std::size_t chunk = 16;
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  if (threads > nseeds / chunk + 1)
+    threads = nseeds / chunk + 1;
+
+  std::size_t len = m.prefixLength();
+  std::atomic<std::size_t> cursor(0);
+  auto work = [&] {
+    beam_search search(m, width, length);
+    std::size_t first;
+    while ((first = cursor.fetch_add(chunk)) < nseeds) {
+      std::size_t end = std::min(first + chunk, nseeds);
+      for (std::size_t k = first; k < end; k++)
+        lengths[k] = search.run(seeds + k * len, out + k * length,
+                                logprobs ? logprobs + k : NULL);
+    }
+  };
+  std::vector<std::thread> workers;
+  for (unsigned t = 1; t < threads; t++)
+    workers.push_back(std::thread(work));
+  work();
+  for (std::size_t t = 0; t < workers.size(); t++)
+    workers[t].join();
+}
+
+}
@@ -0,0 +1,190 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <config.h>
+#include <sink.hh>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+
+#include <unistd.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+namespace markov {
+
+fd_sink::fd_sink(int out, std::size_t bufsize, std::size_t refsize) :
+  fd(out), buffer_size(bufsize ? bufsize : 1),
+  reference_size(std::min(refsize, this->buffer_size)),
+  staging(this->buffer_size), staged(0), run(0), waiting(0), written(0),
+  failed(false), blocked(false) {
+  this->iov.reserve(IOV_MAX);
+}
+
+fd_sink::~fd_sink() {
+  this->flush();
+}
+
+// Close the run of staged bytes not yet covered by an iovec.
+void fd_sink::endRun() {
+  if (this->staged > this->run) {
+    iovec v;
+    v.iov_base = &this->staging[this->run];
+    v.iov_len = this->staged - this->run;
+    this->iov.push_back(v);
+    this->run = this->staged;
+  }
+}
+
+// Make room to stage n more bytes.  A flush normally empties the
+// staging buffer, but on a descriptor that would block, staged bytes
+// still waiting to be written are moved down to the start of the
+// buffer if that frees at least half of it, and to a buffer twice the
+// size if not, so that a slow reader does not make every add move the
+// whole queue.  Either way the iovecs that point into it are moved to
+// match.
+void fd_sink::makeRoom(std::size_t n) {
+  if (!this->blocked)
+    this->flush();
+  if (this->staged + n <= this->staging.size())
+    return;
+
+  char *first = this->staging.data();
+  char *last = first + this->staged;
+  std::size_t keep = this->run;
+  for (std::size_t i = 0; i < this->iov.size(); i++) {
+    char *p = static_cast<char *>(this->iov[i].iov_base);
+    if (p >= first && p < last) {
+      keep = p - first;
+      break;
+    }
+  }
+  std::vector<char> bigger;
+  char *to = first;
+  if (2 * keep < this->staging.size()
+      || this->staged - keep + n > this->staging.size()) {
+    bigger.resize(std::max(2 * this->staging.size(),
+                           this->staged - keep + n));
+    to = bigger.data();
+  }
+  std::memmove(to, first + keep, this->staged - keep);
+  for (std::size_t i = 0; i < this->iov.size(); i++) {
+    char *p = static_cast<char *>(this->iov[i].iov_base);
+    if (p >= first && p < last)
+      this->iov[i].iov_base = to + (p - first - keep);
+  }
+  this->staged -= keep;
+  this->run -= keep;
+  if (!bigger.empty())
+    this->staging.swap(bigger);
+}
+
+void fd_sink::add(std::string_view w) {
+  if (w.size() >= this->reference_size) {
+    this->endRun();
+    iovec v;
+    v.iov_base = const_cast<char *>(w.data());
+    v.iov_len = w.size();
+    this->iov.push_back(v);
+  }
+  else {
+    if (this->staged + w.size() > this->staging.size())
+      this->makeRoom(w.size());
+    std::memcpy(&this->staging[this->staged], w.data(), w.size());
+    this->staged += w.size();
+  }
+  this->waiting += w.size();
+  if (this->waiting >= this->buffer_size && !this->blocked)
+    this->flush();
+}
+
+void fd_sink::add(char c) {
+  if (this->staged == this->staging.size())
+    this->makeRoom(1);
+  this->staging[this->staged++] = c;
+  if (++this->waiting >= this->buffer_size && !this->blocked)
+    this->flush();
+}
+
+void fd_sink::add(const vocabulary& dict, const token *ids, std::size_t n,
+                  char sep) {
+  for (std::size_t i = 0; i < n; i++) {
+    if (i)
+      this->add(sep);
+    this->add(dict.word(ids[i]));
+  }
+}
+
+bool fd_sink::flush() {
+  this->endRun();
+  this->blocked = false;
+  std::size_t i = 0;
+  while (!this->failed && i < this->iov.size()) {
+    int cnt = static_cast<int>(std::min<std::size_t>(this->iov.size() - i,
+                                                     IOV_MAX));
+    ssize_t n = ::writev(this->fd, &this->iov[i], cnt);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      this->blocked = true;
+      break;
+    }
+    if (n <= 0) {
+      this->failed = true;
+      break;
+    }
+    this->written += n;
+    this->waiting -= n;
+    std::size_t left = static_cast<std::size_t>(n);
+    while (i < this->iov.size() && left >= this->iov[i].iov_len)
+      left -= this->iov[i++].iov_len;
+    if (left > 0) {
+      this->iov[i].iov_base = static_cast<char *>(this->iov[i].iov_base)
+        + left;
+      this->iov[i].iov_len -= left;
+    }
+  }
+  // What could not be written yet stays queued for the next flush.
+  if (this->blocked) {
+    this->iov.erase(this->iov.begin(), this->iov.begin() + i);
+    return true;
+  }
+  this->iov.clear();
+  this->staged = 0;
+  this->run = 0;
+  this->waiting = 0;
+  return !this->failed;
+}
+
+std::size_t fd_sink::pending() const {
+  return this->waiting;
+}
+
+bool fd_sink::good() const {
+  return !this->failed;
+}
+
+unsigned long long fd_sink::bytes() const {
+  return this->written;
+}
+
+}
@@ -0,0 +1,252 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <config.h>
+#include <tokens.hh>
+#include "words.hh"
+
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace markov {
+
+static const char token_magic[8] = { 'M', 'K', 'V', 'T', 'O', 'K', '0', '1' };
+
+struct token_header {
+  char magic[8];
+  std::uint64_t ntokens;
+  std::uint64_t nwords;
+  std::uint64_t ids_offset;
+  std::uint64_t offsets_offset;
+  std::uint64_t text_offset;
+  std::uint64_t reserved[2];
+};
+
+static_assert(sizeof(token_header) == 64, "token file header size");
+
+token_writer::token_writer(const std::string& path) :
+  out(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc),
+  ntokens(0), nwritten(0), in_document(false), closed(false) {
+  token_header h;
+  std::memset(&h, 0, sizeof(h));
+  this->out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+  this->pending.reserve(1 << 16);
+}
+
+token_writer::~token_writer() {
+  this->close();
+}
+
+bool token_writer::good() const {
+  return !this->closed && this->out.good();
+}
+
+void token_writer::add(std::string_view w) {
+  this->pending.push_back(this->vocab.intern(w));
+  this->ntokens++;
+  this->in_document = true;
+  if (this->pending.size() >= (1 << 16))
+    this->flush();
+}
+
+void token_writer::add(source& in) {
+  splitWords(in,
+             [this](std::string_view w) { this->add(w); },
+             [this](std::size_t) { this->endDocument(); });
+  this->endDocument();
+}
+
+void token_writer::endDocument() {
+  if (this->in_document) {
+    this->pending.push_back(document_break);
+    this->in_document = false;
+  }
+}
+
+void token_writer::flush() {
+  this->out.write(reinterpret_cast<const char *>(this->pending.data()),
+                  this->pending.size() * sizeof(token));
+  this->nwritten += this->pending.size();
+  this->pending.clear();
+}
+
+bool token_writer::close() {
+  if (this->closed)
+    return true;
+  this->closed = true;
+
+  // A break after the last document carries no information.
+  if (!this->in_document && !this->pending.empty()
+      && this->pending.back() == document_break)
+    this->pending.pop_back();
+  this->flush();
+
+  token_header h;
+  std::memset(&h, 0, sizeof(h));
+  std::memcpy(h.magic, token_magic, sizeof(h.magic));
+  h.ntokens = this->nwritten;
+  h.nwords = this->vocab.size();
+  h.ids_offset = sizeof(h);
+  h.offsets_offset = h.ids_offset + h.ntokens * sizeof(token);
+  if (h.offsets_offset % 8 != 0) {
+    static const char pad[8] = { 0 };
+    this->out.write(pad, 8 - h.offsets_offset % 8);
+    h.offsets_offset += 8 - h.offsets_offset % 8;
+  }
+  const std::vector<std::uint64_t>& starts = this->vocab.starts();
+  this->out.write(reinterpret_cast<const char *>(starts.data()),
+                  starts.size() * sizeof(std::uint64_t));
+  h.text_offset = h.offsets_offset + starts.size() * sizeof(std::uint64_t);
+  this->out.write(this->vocab.bytes().data(), this->vocab.bytes().size());
+
+  this->out.seekp(0);
+  this->out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+  this->out.close();
+  return !this->out.fail();
+}
+
+unsigned long long token_writer::tokens() const {
+  return this->ntokens;
+}
+
+const vocabulary& token_writer::words() const {
+  return this->vocab;
+}
+
+token_file::token_file() :
+  map(MAP_FAILED), map_size(0), ids(NULL), nids(0), offsets(NULL),
+  text(NULL), nwords(0) {}
+
+token_file::token_file(const std::string& path) :
+  map(MAP_FAILED), map_size(0), ids(NULL), nids(0), offsets(NULL),
+  text(NULL), nwords(0) {
+  this->open(path);
+}
+
+token_file::~token_file() {
+  this->close();
+}
+
+bool token_file::open(const std::string& path) {
+  this->close();
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (::fstat(fd, &st) < 0
+      || static_cast<std::size_t>(st.st_size) < sizeof(token_header)) {
+    ::close(fd);
+    return false;
+  }
+  this->map_size = st.st_size;
+  this->map = ::mmap(NULL, this->map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (this->map == MAP_FAILED)
+    return false;
+
+  const char *base = static_cast<const char *>(this->map);
+  token_header h;
+  std::memcpy(&h, base, sizeof(h));
+  bool valid = std::memcmp(h.magic, token_magic, sizeof(h.magic)) == 0
+    && h.ids_offset <= this->map_size && h.offsets_offset <= this->map_size
+    && h.ids_offset % sizeof(token) == 0
+    && h.offsets_offset % sizeof(std::uint64_t) == 0
+    && h.ntokens <= (this->map_size - h.ids_offset) / sizeof(token)
+    && h.nwords < (this->map_size - h.offsets_offset) / sizeof(std::uint64_t)
+    && h.text_offset <= this->map_size;
+  if (valid) {
+    this->offsets = reinterpret_cast<const std::uint64_t *>(
+      base + h.offsets_offset);
+    valid = this->offsets[0] == 0
+      && this->offsets[h.nwords] <= this->map_size - h.text_offset;
+    for (std::uint64_t i = 0; valid && i < h.nwords; i++)
+      valid = this->offsets[i] <= this->offsets[i + 1];
+  }
+  if (!valid) {
+    this->close();
+    return false;
+  }
+
+  this->ids = reinterpret_cast<const token *>(base + h.ids_offset);
+  this->nids = h.ntokens;
+  this->text = base + h.text_offset;
+  this->nwords = h.nwords;
+  ::madvise(this->map, this->map_size, MADV_SEQUENTIAL);
+  return true;
+}
+
+void token_file::close() {
+  if (this->map != MAP_FAILED)
+    ::munmap(this->map, this->map_size);
+  this->map = MAP_FAILED;
+  this->map_size = 0;
+  this->ids = NULL;
+  this->nids = 0;
+  this->offsets = NULL;
+  this->text = NULL;
+  this->nwords = 0;
+}
+
+bool token_file::isOpen() const {
+  return this->map != MAP_FAILED;
+}
+
+const token *token_file::begin() const {
+  return this->ids;
+}
+
+const token *token_file::end() const {
+  return this->ids + this->nids;
+}
+
+std::size_t token_file::size() const {
+  return this->nids;
+}
+
+std::size_t token_file::words() const {
+  return this->nwords;
+}
+
+std::string_view token_file::word(token t) const {
+  return std::string_view(this->text + this->offsets[t],
+                          this->offsets[t + 1] - this->offsets[t]);
+}
+
+vocabulary token_file::dictionary() const {
+  if (!this->isOpen())
+    return vocabulary();
+  return vocabulary(this->text, this->offsets, this->nwords);
+}
+
+bool token_file::check(const std::string& path) {
+  // Token files are mapped, so only a regular file can be one, and
+  // probing a pipe would eat the start of its text.
+  struct stat st;
+  if (::stat(path.c_str(), &st) < 0 || !S_ISREG(st.st_mode))
+    return false;
+  std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+  char magic[sizeof(token_magic)];
+  return in.read(magic, sizeof(magic))
+    && std::memcmp(magic, token_magic, sizeof(magic)) == 0;
+}
+
+}
@@ -0,0 +1,125 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <config.h>
+#include <vocabulary.hh>
+
+#include <cstring>
+
+namespace markov {
+
+// FNV-1a; words are short, so a simple byte loop is hard to beat.
+static inline std::uint64_t hashWord(std::string_view w)
+{
+  std::uint64_t h = 14695981039346656037ULL;
+  for (std::size_t i = 0; i < w.size(); i++) {
+    h ^= static_cast<unsigned char>(w[i]);
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+vocabulary::vocabulary() : offsets(1, 0), slots(16, no_token) {}
+
+vocabulary::vocabulary(const char *chars, const std::uint64_t *starts,
+                       std::size_t count) :
+  text(chars, starts[count]), offsets(starts, starts + count + 1),
+  slots(16, no_token) {
+  while (this->slots.size() < 2 * (count + 1))
+    this->slots.resize(this->slots.size() * 2);
+  this->slots.assign(this->slots.size(), no_token);
+  for (token t = 0; t < count; t++) {
+    std::size_t i = this->probe(this->word(t));
+    if (this->slots[i] == no_token)
+      this->slots[i] = t;
+  }
+}
+
+// Find the slot holding w, or the empty slot where it belongs.
+std::size_t vocabulary::probe(std::string_view w) const {
+  std::size_t mask = this->slots.size() - 1;
+  std::size_t i = hashWord(w) & mask;
+  while (this->slots[i] != no_token && this->word(this->slots[i]) != w)
+    i = (i + 1) & mask;
+  return i;
+}
+
+void vocabulary::grow() {
+  std::vector<token> old(this->slots.size() * 2, no_token);
+  old.swap(this->slots);
+  std::size_t mask = this->slots.size() - 1;
+  for (std::size_t j = 0; j < old.size(); j++) {
+    if (old[j] == no_token)
+      continue;
+    std::size_t i = hashWord(this->word(old[j])) & mask;
+    while (this->slots[i] != no_token)
+      i = (i + 1) & mask;
+    this->slots[i] = old[j];
+  }
+}
+
+token vocabulary::intern(std::string_view w) {
+  std::size_t i = this->probe(w);
+  if (this->slots[i] != no_token)
+    return this->slots[i];
+
+  token t = static_cast<token>(this->size());
+  this->text.append(w.data(), w.size());
+  this->offsets.push_back(this->text.size());
+  this->slots[i] = t;
+  if (2 * this->size() > this->slots.size())
+    this->grow();
+  return t;
+}
+
+token vocabulary::find(std::string_view w) const {
+  return this->slots[this->probe(w)];
+}
+
+std::size_t vocabulary::joinedLength(const token *ids, std::size_t n) const {
+  std::size_t len = n ? n - 1 : 0;
+  for (std::size_t i = 0; i < n; i++)
+    len += this->offsets[ids[i] + 1] - this->offsets[ids[i]];
+  return len;
+}
+
+std::size_t vocabulary::join(const token *ids, std::size_t n, char *buf,
+                             std::size_t size, char sep) const {
+  const char *chars = this->text.data();
+  std::size_t pos = 0;
+  for (std::size_t i = 0; i < n; i++) {
+    std::size_t start = this->offsets[ids[i]];
+    std::size_t len = this->offsets[ids[i] + 1] - start;
+    std::size_t need = len + (i ? 1 : 0);
+    if (need > size - pos)
+      break;
+    if (i)
+      buf[pos++] = sep;
+    std::memcpy(buf + pos, chars + start, len);
+    pos += len;
+  }
+  return pos;
+}
+
+void vocabulary::clear() {
+  this->text.clear();
+  this->offsets.assign(1, 0);
+  this->slots.assign(16, no_token);
+}
+
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MARKOV_WORDS_HH_INCL
+#define MARKOV_WORDS_HH_INCL
+
+#include <source.hh>
+#include <string>
+#include <string_view>
+
+namespace markov {
+
+// The characters operator>> treats as whitespace in the C locale.
+inline bool isSpace(char c)
+{
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+// Whether a word ends a sentence: it ends in '.', '!' or '?'.
+inline bool endsSentence(std::string_view w)
+{
+  return !w.empty() && (w.back() == '.' || w.back() == '!' || w.back() == '?');
+}
+
+// Split the blocks of a source into words the way operator>> would.
+// document(n) is called at the start of each document and word(w)
+// for each word.  Words that lie inside one block are passed as views
+// of the block; only words cut by a block boundary are copied.
+template <class Word, class Document>
+void splitWords(source& in, Word word, Document document)
+{
+  buffer b;
+  std::string partial;
+  while (in.next(b)) {
+    if (b.first)
+      document(b.document);
+    const char *p = b.data;
+    const char *end = p + b.size;
+    while (p < end) {
+      if (isSpace(*p)) {
+        if (!partial.empty()) {
+          word(std::string_view(partial));
+          partial.clear();
+        }
+        p++;
+        continue;
+      }
+      const char *q = p;
+      while (q < end && !isSpace(*q))
+        q++;
+      if (q < end && partial.empty())
+        word(std::string_view(p, q - p));
+      else
+        partial.append(p, q);
+      p = q;
+    }
+    if (b.last && !partial.empty()) {
+      word(std::string_view(partial));
+      partial.clear();
+    }
+  }
+  if (!partial.empty())
+    word(std::string_view(partial));
+}
+
+}
+
+#endif // MARKOV_WORDS_HH_INCL
@@ -0,0 +1,158 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <chain.hh>
+#include <constraints.hh>
+#include <philox.hh>
+#include <sampler.hh>
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace markov;
+
+namespace {
+
+int failures = 0;
+
+void fail(const char *what) {
+  std::fprintf(stderr, "%s\n", what);
+  failures++;
+}
+
+}
+
+int main() {
+  chain::setSeed(1);
+
+  // a -> b -> c -> d -> . and a -> b -> ., then . -> a or . -> x -> y,
+  // which reaches no ending.
+  model m(1);
+  for (const char *w : { "a", "b", "c", "d", ".", "a", "b", ".", "x", "y" })
+    m.add(std::string_view(w));
+  const vocabulary& v = m.words();
+  token a = v.find("a"), b = v.find("b"), c = v.find("c"), d = v.find("d");
+  token stop = v.find("."), x = v.find("x"), y = v.find("y");
+  m.freeze();
+
+  word_set terminals(v.size());
+  terminals.insert(stop);
+  endings ends(m, terminals);
+  const struct {
+    token t;
+    std::uint32_t dist;
+  } want[] = {
+    { a, 2 }, { b, 1 }, { c, 2 }, { d, 1 }, { stop, 3 },
+    { x, endings::unreachable }, { y, endings::unreachable }
+  };
+  for (const auto& w : want) {
+    if (ends.distance(m.find(&w.t)) != w.dist) {
+      std::fprintf(stderr, "distance from %s is %u, expected %u\n",
+                   std::string(v.word(w.t)).c_str(),
+                   ends.distance(m.find(&w.t)), w.dist);
+      failures++;
+    }
+  }
+  if (ends.distance(model::no_state) != endings::unreachable)
+    fail("no_state is not unreachable");
+  if (!ends.terminal(stop) || ends.terminal(a))
+    fail("the terminal words are wrong");
+
+  sampler gen(m);
+  word_set none(v.size());
+  token out[16];
+
+  // With two words left after a, only b . ends in time.
+  for (int i = 0; i < 50; i++) {
+    if (gen.generate(out, 3, &a, &none, &ends) != 3
+        || out[1] != b || out[2] != stop) {
+      fail("a run that must end in two words did not");
+      break;
+    }
+  }
+
+  // Banning c leaves b . as the only way on from a; banning b leaves
+  // nothing, and the run stops at the prefix.
+  word_set no_c(v.size());
+  no_c.insert(c);
+  for (int i = 0; i < 50; i++) {
+    if (gen.generate(out, 16, &a, &no_c, &ends) != 3 || out[2] != stop) {
+      fail("a banned word was generated");
+      break;
+    }
+  }
+  word_set no_b(v.size());
+  no_b.insert(b);
+  if (gen.generate(out, 16, &a, &no_b, &ends) != 1)
+    fail("a run went on with every successor banned");
+
+  // Every run stops at the first ending, and never wanders to x.
+  for (int i = 0; i < 200; i++) {
+    const token *pref = i % 2 ? &stop : NULL;
+    std::size_t n = gen.generate(out, 16, pref, &none, &ends);
+    if (n < 2 || out[n - 1] != stop) {
+      fail("a run did not end on a terminal word");
+      break;
+    }
+    for (std::size_t j = 1; j + 1 < n; j++)
+      if (out[j] == stop || out[j] == x)
+        fail("a run went past an ending or away from one");
+  }
+
+  // On a larger model, banned words are never generated and only the
+  // last word of a run is terminal.
+  model big(2);
+  philox text(11);
+  for (int i = 0; i < 20000; i++) {
+    std::uint64_t r = text.below(40);
+    big.add(r < 4 ? std::string(".") : "w" + std::to_string(r));
+  }
+  big.freeze();
+  word_set big_ends(big.words().size());
+  big_ends.insert(big.words().find("."));
+  endings big_endings(big, big_ends);
+  word_set banned(big.words().size());
+  for (int i = 4; i < 8; i++)
+    banned.insert(big.words().find("w" + std::to_string(i)));
+  sampler big_gen(big);
+  big_gen.setTemperature(0.8);
+  token run[32];
+  int ended = 0;
+  for (int i = 0; i < 500; i++) {
+    std::size_t n = big_gen.generate(run, 32, NULL, &banned, &big_endings);
+    for (std::size_t j = 0; j < n; j++) {
+      if (banned.contains(run[j])) {
+        fail("a banned word was generated on the larger model");
+        i = 500;
+        break;
+      }
+      if (j >= 2 && j + 1 < n && big_ends.contains(run[j])) {
+        fail("a run on the larger model went past an ending");
+        i = 500;
+        break;
+      }
+    }
+    if (n > 0 && big_ends.contains(run[n - 1]))
+      ended++;
+  }
+  if (ended < 490)
+    fail("too few runs on the larger model ended on a terminal word");
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <model.hh>
+#include <philox.hh>
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace markov;
+
+namespace {
+
+int failures = 0;
+
+void fail(const char *what, unsigned threads) {
+  std::fprintf(stderr, "%s with %u threads\n", what, threads);
+  failures++;
+}
+
+}
+
+int main() {
+  // Train on text drawn from a small vocabulary, so that states have
+  // several successors and some dead ends.
+  model m(2);
+  philox text(7);
+  for (int i = 0; i < 20000; i++)
+    m.add(std::to_string(text.below(60)));
+  m.freeze();
+
+  const std::uint64_t seed = 12345;
+  const std::size_t count = 500, nwords = 24;
+  std::vector<token> want(count * nwords);
+  std::vector<std::size_t> want_len(count);
+  m.generateBatch(seed, count, nwords, want.data(), want_len.data(),
+                  true, 1);
+
+  // Sample k is the walk drawn from stream k.
+  for (std::size_t k = 0; k < count; k++) {
+    philox rng(seed, k);
+    std::vector<token> one(nwords);
+    std::size_t len = m.generate(one.data(), nwords, NULL, true, rng);
+    if (len != want_len[k]
+        || !std::equal(one.begin(), one.begin() + len,
+                       want.begin() + k * nwords)) {
+      fail("a sample differs from its stream", 1);
+      break;
+    }
+  }
+
+  for (unsigned threads : { 2u, 3u, 4u, 8u }) {
+    std::vector<token> got(count * nwords);
+    std::vector<std::size_t> got_len(count);
+    m.generateBatch(seed, count, nwords, got.data(), got_len.data(),
+                    true, threads);
+    if (got_len != want_len)
+      fail("the sample lengths differ", threads);
+    for (std::size_t k = 0; k < count; k++) {
+      if (!std::equal(got.begin() + k * nwords,
+                      got.begin() + k * nwords + got_len[k],
+                      want.begin() + k * nwords)) {
+        fail("the samples differ", threads);
+        break;
+      }
+    }
+
+    // A run made a batch at a time matches one made all at once.
+    const std::size_t half = count / 2;
+    std::vector<std::size_t> rest_len(count - half);
+    std::vector<token> rest((count - half) * nwords);
+    m.generateBatch(seed, count - half, nwords, rest.data(),
+                    rest_len.data(), true, threads, NULL, half);
+    for (std::size_t k = 0; k < count - half; k++) {
+      if (rest_len[k] != want_len[half + k]
+          || !std::equal(rest.begin() + k * nwords,
+                         rest.begin() + k * nwords + rest_len[k],
+                         want.begin() + (half + k) * nwords)) {
+        fail("a later batch differs", threads);
+        break;
+      }
+    }
+  }
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <corpus.hh>
+#include <ingest.hh>
+#include <philox.hh>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace markov;
+
+namespace {
+
+int failures = 0;
+
+// Two chains are the same if they have the same prefixes, each
+// followed by the same words the same number of times, in any order.
+bool same(const chain& a, const chain& b) {
+  if (a.size() != b.size())
+    return false;
+  for (chain::const_iterator i = a.begin(), j = b.begin(); i != a.end();
+       ++i, ++j) {
+    if (i->first != j->first)
+      return false;
+    std::vector<std::string> x(i->second), y(j->second);
+    std::sort(x.begin(), x.end());
+    std::sort(y.begin(), y.end());
+    if (x != y)
+      return false;
+  }
+  return true;
+}
+
+}
+
+int main() {
+  // Files of every length from empty up, some shorter than a prefix,
+  // so that the joins between them are tested at every offset.
+  const std::string dir = "ingest-test.d";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directory(dir);
+  std::vector<std::string> files;
+  philox text(3);
+  for (int f = 0; f < 40; f++) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/%02d.txt", f);
+    files.push_back(dir + name);
+    std::ofstream out(files.back());
+    int nwords = f < 8 ? f : static_cast<int>(text.below(200));
+    for (int i = 0; i < nwords; i++)
+      out << "w" << text.below(12) << (i % 9 == 8 ? "\n" : " ");
+  }
+
+  for (std::size_t len = 1; len <= 3; len++) {
+    for (bool resetprefix : { false, true }) {
+      chain want(len);
+      corpus_reader reader(files);
+      want.add(reader, resetprefix);
+
+      for (unsigned threads : { 1u, 2u, 3u, 4u }) {
+        for (std::size_t batch : { 1, 3, 64 }) {
+          chain got(len);
+          ingest_stats stats = ingest(got, files, threads, batch,
+                                      resetprefix);
+          if (!stats.errors.empty() || stats.files != files.size()
+              || !same(got, want)) {
+            std::fprintf(stderr, "prefix %zu, %s, %u threads, batches of "
+                         "%zu: not the chain trained on one thread\n", len,
+                         resetprefix ? "reset" : "no reset", threads, batch);
+            failures++;
+          }
+        }
+      }
+    }
+  }
+
+  std::filesystem::remove_all(dir);
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <philox.hh>
+
+#include <cstdint>
+#include <cstdio>
+
+using namespace markov;
+
+namespace {
+
+int failures = 0;
+
+void expect(const char *what, const std::uint32_t got[4],
+            const std::uint32_t want[4]) {
+  for (int i = 0; i < 4; i++) {
+    if (got[i] != want[i]) {
+      std::fprintf(stderr, "%s: word %d is %08x, expected %08x\n",
+                   what, i, got[i], want[i]);
+      failures++;
+    }
+  }
+}
+
+}
+
+int main() {
+  // The known-answer vectors published with Random123 for
+  // Philox4x32-10.
+  const struct {
+    const char *name;
+    std::uint32_t ctr[4];
+    std::uint32_t key[2];
+    std::uint32_t out[4];
+  } kat[] = {
+    { "zero",
+      { 0x00000000, 0x00000000, 0x00000000, 0x00000000 },
+      { 0x00000000, 0x00000000 },
+      { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 } },
+    { "ones",
+      { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff },
+      { 0xffffffff, 0xffffffff },
+      { 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd } },
+    { "pi",
+      { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 },
+      { 0xa4093822, 0x299f31d0 },
+      { 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 } }
+  };
+  for (const auto& v : kat) {
+    std::uint32_t out[4];
+    philox::block(v.ctr, v.key, out);
+    expect(v.name, out, v.out);
+  }
+
+  // The counter is (index, stream) and the key is the seed, so the
+  // first block of a stream is a known answer too.
+  philox zero(0, 0);
+  std::uint32_t first[4];
+  for (int i = 0; i < 4; i++)
+    first[i] = zero();
+  expect("stream", first, kat[0].out);
+
+  philox ones(0xffffffffffffffffULL, 0xffffffffffffffffULL);
+  std::uint32_t ctr[4] = { 0, 0, 0xffffffff, 0xffffffff };
+  std::uint32_t key[2] = { 0xffffffff, 0xffffffff };
+  std::uint32_t want[4];
+  philox::block(ctr, key, want);
+  for (int i = 0; i < 4; i++)
+    first[i] = ones();
+  expect("stream ones", first, want);
+
+  // Every way of drawing must give the numbers of the single-block
+  // function, across the batched lanes and odd lengths.
+  const std::uint64_t seed = 0x0123456789abcdefULL, stream = 42;
+  const std::size_t n = 4 * 100 + 3;
+  std::uint32_t ref[n];
+  key[0] = static_cast<std::uint32_t>(seed);
+  key[1] = static_cast<std::uint32_t>(seed >> 32);
+  for (std::size_t b = 0; b * 4 < n; b++) {
+    std::uint32_t c[4] = {
+      static_cast<std::uint32_t>(b), 0,
+      static_cast<std::uint32_t>(stream), 0
+    };
+    std::uint32_t out[4];
+    philox::block(c, key, out);
+    for (int i = 0; i < 4 && b * 4 + i < n; i++)
+      ref[b * 4 + i] = out[i];
+  }
+
+  philox one(seed, stream);
+  for (std::size_t i = 0; i < n; i++) {
+    std::uint32_t r = one();
+    if (r != ref[i]) {
+      std::fprintf(stderr, "operator(): number %zu is %08x, expected %08x\n",
+                   i, r, ref[i]);
+      failures++;
+      break;
+    }
+  }
+
+  philox bulk(seed, stream);
+  std::uint32_t got[n];
+  bulk.generate(got, 5);
+  bulk.generate(got + 5, 1);
+  bulk.generate(got + 6, n - 6);
+  for (std::size_t i = 0; i < n; i++) {
+    if (got[i] != ref[i]) {
+      std::fprintf(stderr, "generate: number %zu is %08x, expected %08x\n",
+                   i, got[i], ref[i]);
+      failures++;
+      break;
+    }
+  }
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <model.hh>
+
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace markov;
+
+namespace {
+
+int failures = 0;
+
+void expect(const char *what, double got, double want) {
+  if (std::isinf(want) ? got != want : std::fabs(got - want) > 1e-12) {
+    std::fprintf(stderr, "%s: %.17g, expected %.17g\n", what, got, want);
+    failures++;
+  }
+}
+
+}
+
+int main() {
+  // a is followed by b twice and by c once; b and c by a.
+  model m(1);
+  for (const char *w : { "a", "b", "a", "c", "a", "b", "a" })
+    m.add(std::string_view(w));
+  token a = m.words().find("a");
+  token b = m.words().find("b");
+  token c = m.words().find("c");
+
+  std::vector<token> seq = { a, b, a, c, a };
+  std::vector<double> each(seq.size());
+  double want = std::log(2.0 / 3) + std::log(1.0) + std::log(1.0 / 3)
+    + std::log(1.0);
+  expect("score", m.score(seq.data(), seq.size(), each.data()), want);
+  expect("first token", each[0], 0.0);
+  expect("a b", each[1], std::log(2.0 / 3));
+  expect("b a", each[2], 0.0);
+  expect("a c", each[3], std::log(1.0 / 3));
+  expect("c a", each[4], 0.0);
+
+  // Too short to have a transition, and transitions never seen.
+  expect("one token", m.score(seq.data(), 1), 0.0);
+  std::vector<token> unseen = { a, a };
+  expect("unseen", m.score(unseen.data(), unseen.size()), -INFINITY);
+  std::vector<token> unknown = { b, no_token, a };
+  expect("unknown", m.score(unknown.data(), unknown.size()), -INFINITY);
+
+  // A long run of likely tokens must not underflow to -inf, and a
+  // frozen model scores as a thawed one does.
+  std::vector<token> run;
+  for (int i = 0; i < 4000; i++) {
+    run.push_back(a);
+    run.push_back(i % 3 == 2 ? c : b);
+  }
+  double thawed = m.score(run.data(), run.size());
+  if (!std::isfinite(thawed)) {
+    std::fprintf(stderr, "a long run scores %g\n", thawed);
+    failures++;
+  }
+  m.freeze();
+  expect("frozen", m.score(run.data(), run.size()), thawed);
+
+  // Scoring in a batch gives each sequence's score, whatever the
+  // thread count.
+  std::vector<token> ids;
+  std::vector<std::size_t> starts = { 0 };
+  std::vector<double> single;
+  for (std::size_t n = 0; n < 200; n++) {
+    std::size_t len = n % 17;
+    std::size_t at = ids.size();
+    for (std::size_t i = 0; i < len; i++)
+      ids.push_back(run[(n + i) % run.size()]);
+    if (n % 11 == 5 && len > 2)
+      ids[at + len / 2] = ids[at + len / 2 - 1];
+    starts.push_back(ids.size());
+    single.push_back(m.score(ids.data() + at, len));
+  }
+  for (unsigned threads : { 1u, 2u, 4u }) {
+    std::vector<double> out(single.size());
+    m.scoreBatch(ids.data(), starts.data(), single.size(), out.data(),
+                 threads);
+    for (std::size_t i = 0; i < out.size(); i++) {
+      if (out[i] != single[i]) {
+        std::fprintf(stderr, "sequence %zu with %u threads: %g, expected "
+                     "%g\n", i, threads, out[i], single[i]);
+        failures++;
+        break;
+      }
+    }
+  }
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <model.hh>
+#include <philox.hh>
+#include <small_list.hh>
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace markov;
+
+namespace {
+
+int failures = 0;
+
+void fail(const char *what) {
+  std::fprintf(stderr, "%s\n", what);
+  failures++;
+}
+
+template <class List>
+bool holds(const List& l, const std::vector<std::uint64_t>& want) {
+  if (l.size() != want.size())
+    return false;
+  for (std::size_t i = 0; i < want.size(); i++)
+    if (l[i] != want[i])
+      return false;
+  return true;
+}
+
+}
+
+int main() {
+  typedef small_list<std::uint64_t, 2> list;
+
+  // The list stays inline up to its capacity, then moves to the heap
+  // without losing anything.
+  list l;
+  std::vector<std::uint64_t> want;
+  for (std::uint64_t i = 0; i < 100; i++) {
+    l.push_back(i * i);
+    want.push_back(i * i);
+    if (l.spilled() != (want.size() > list::inline_capacity))
+      fail("the list spilled at the wrong size");
+    if (!holds(l, want)) {
+      fail("a push_back lost an element");
+      break;
+    }
+  }
+
+  list copy(l);
+  if (!holds(copy, want))
+    fail("a spilled list did not copy");
+  list moved(std::move(copy));
+  if (!holds(moved, want) || !copy.empty() || copy.spilled())
+    fail("a spilled list did not move");
+
+  list small;
+  small.push_back(7);
+  list small_copy(small);
+  small_copy.push_back(8);
+  if (!holds(small, { 7 }) || !holds(small_copy, { 7, 8 })
+      || small_copy.spilled())
+    fail("an inline list did not copy");
+  small_copy = l;
+  if (!holds(small_copy, want))
+    fail("assignment to an inline list failed");
+  l = std::move(small);
+  if (!holds(l, { 7 }) || l.spilled())
+    fail("move assignment to a spilled list failed");
+  moved.clear();
+  if (!moved.empty() || moved.spilled())
+    fail("clear did not return the list to inline storage");
+  moved.push_back(1);
+  if (!holds(moved, { 1 }))
+    fail("a cleared list cannot be reused");
+
+  // Model states with one, two and three successors, the last of
+  // which no longer fits inline, keep their counts; a state with one
+  // successor always gives it.
+  model m(1);
+  const char *text[] = {
+    "one", "x", "one", "x",
+    "two", "x", "two", "y", "two", "x",
+    "three", "x", "three", "y", "three", "z", "three", "z"
+  };
+  for (const char *w : text)
+    m.add(std::string_view(w));
+  const vocabulary& v = m.words();
+  const struct {
+    const char *pref;
+    const char *word;
+    std::uint32_t count;
+  } counts[] = {
+    { "one", "x", 2 }, { "two", "x", 2 }, { "two", "y", 1 },
+    { "three", "x", 1 }, { "three", "y", 1 }, { "three", "z", 2 }
+  };
+  for (int pass = 0; pass < 2; pass++) {
+    for (const auto& c : counts) {
+      token p = v.find(c.pref);
+      model::state s = m.find(&p);
+      if (s == model::no_state || m.count(s, v.find(c.word)) != c.count) {
+        std::fprintf(stderr, "%s %s was not counted %u times\n", c.pref,
+                     c.word, c.count);
+        failures++;
+      }
+    }
+    m.freeze();
+  }
+
+  token one = v.find("one");
+  philox rng(5);
+  for (int i = 0; i < 20; i++) {
+    token out[2];
+    if (m.generate(out, 2, &one, false, rng) != 2 || out[1] != v.find("x")) {
+      fail("a state with one successor gave another word");
+      break;
+    }
+  }
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <model.hh>
+#include <philox.hh>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace markov;
+
+namespace {
+
+int failures = 0;
+
+// How many times word i follows a state.
+std::uint32_t weight(std::size_t i) {
+  return 1 + (i * 7) % 13;
+}
+
+// Check every count of a state with fanout successors, named
+// prefix + "-" + i.
+void checkCounts(const model& m, const std::string& pref,
+                 std::size_t fanout, std::uint32_t scale) {
+  const vocabulary& v = m.words();
+  token p = v.find(pref);
+  model::state s = m.find(&p);
+  if (s == model::no_state) {
+    std::fprintf(stderr, "%s: no state\n", pref.c_str());
+    failures++;
+    return;
+  }
+  std::uint64_t total = 0;
+  for (std::size_t i = 0; i < fanout; i++) {
+    token t = v.find(pref + "-" + std::to_string(i));
+    if (m.count(s, t) != scale * weight(i)) {
+      std::fprintf(stderr, "%s: word %zu counted %u times, expected %u\n",
+                   pref.c_str(), i, m.count(s, t), scale * weight(i));
+      failures++;
+      return;
+    }
+    total += scale * weight(i);
+  }
+  if (m.successors(s).size() != fanout || m.total(s) != total) {
+    std::fprintf(stderr, "%s: wrong successor list or total\n",
+                 pref.c_str());
+    failures++;
+  }
+  if (m.count(s, p) != 0) {
+    std::fprintf(stderr, "%s: a word that never followed is counted\n",
+                 pref.c_str());
+    failures++;
+  }
+}
+
+// Draw from a state many times and compare the counts of each word
+// with what its weight predicts, by a chi-squared statistic.  The
+// streams are fixed, so this is not a flaky test; the bound is six
+// standard deviations above the mean.
+void checkDraws(const model& m, const std::string& pref,
+                std::size_t fanout) {
+  const vocabulary& v = m.words();
+  token p = v.find(pref);
+  std::uint64_t total = 0;
+  std::vector<std::size_t> index(v.size(), fanout);
+  for (std::size_t i = 0; i < fanout; i++) {
+    total += weight(i);
+    index[v.find(pref + "-" + std::to_string(i))] = i;
+  }
+  const std::size_t draws = 100 * fanout + 10000;
+  std::vector<std::uint64_t> seen(fanout);
+  philox rng(fanout);
+  for (std::size_t d = 0; d < draws; d++) {
+    token out[2];
+    if (m.generate(out, 2, &p, false, rng) != 2 || index[out[1]] == fanout) {
+      std::fprintf(stderr, "%s: drew a word that never followed\n",
+                   pref.c_str());
+      failures++;
+      return;
+    }
+    seen[index[out[1]]]++;
+  }
+  double chi2 = 0;
+  for (std::size_t i = 0; i < fanout; i++) {
+    double want = static_cast<double>(draws) * weight(i) / total;
+    chi2 += (seen[i] - want) * (seen[i] - want) / want;
+  }
+  double df = fanout - 1;
+  if (chi2 > df + 6 * std::sqrt(2 * df)) {
+    std::fprintf(stderr, "%s: draws do not follow the counts, chi2 %g "
+                 "with %g degrees of freedom\n", pref.c_str(), chi2, df);
+    failures++;
+  }
+}
+
+}
+
+int main() {
+  // One state below the hash cut, one above it, and one large enough
+  // for an alias table, trained in a shuffled order.
+  const std::pair<const char *, std::size_t> states[] = {
+    { "few", 20 }, { "hashed", 40 }, { "alias", 3000 }
+  };
+  std::vector<std::pair<std::string, std::string> > pairs;
+  for (const auto& st : states)
+    for (std::size_t i = 0; i < st.second; i++)
+      for (std::uint32_t n = 0; n < weight(i); n++)
+        pairs.push_back(std::make_pair(std::string(st.first),
+                                       st.first + ("-" + std::to_string(i))));
+  philox shuffle(9);
+  for (std::size_t i = pairs.size(); i > 1; i--)
+    std::swap(pairs[i - 1], pairs[shuffle.below(i)]);
+
+  model m(1);
+  for (const auto& pr : pairs) {
+    m.add(pr.first);
+    m.add(pr.second);
+  }
+  for (const auto& st : states)
+    checkCounts(m, st.first, st.second, 1);
+
+  m.freeze();
+  for (const auto& st : states) {
+    checkCounts(m, st.first, st.second, 1);
+    checkDraws(m, st.first, st.second);
+  }
+
+  // Training on after a freeze thaws the model; the counts and draws
+  // must take in the new words.
+  for (const auto& pr : pairs) {
+    m.add(pr.first);
+    m.add(pr.second);
+  }
+  for (const auto& st : states)
+    checkCounts(m, st.first, st.second, 2);
+  m.freeze();
+  for (const auto& st : states) {
+    checkCounts(m, st.first, st.second, 2);
+    checkDraws(m, st.first, st.second);
+  }
+
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <tokens.hh>
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace markov;
+
+namespace {
+
+int failures = 0;
+
+void fail(const char *what) {
+  std::fprintf(stderr, "%s\n", what);
+  failures++;
+}
+
+}
+
+int main() {
+  const std::string path = "tokens-test.tok";
+  const std::vector<std::vector<std::string_view>> documents = {
+    { "the", "cat", "sat", "on", "the", "mat" },
+    { "a", "longer", "word,", "with", "punctuation.", "the" },
+    { "Ünïcödé", "bytes", "survive", "too" }
+  };
+
+  token_writer w(path);
+  for (const auto& d : documents) {
+    for (std::string_view word : d)
+      w.add(word);
+    w.endDocument();
+  }
+  // An empty document writes nothing.
+  w.endDocument();
+  if (!w.close())
+    fail("cannot write the token file");
+
+  if (!token_file::check(path))
+    fail("the token file is not recognized");
+  token_file f;
+  if (!f.open(path)) {
+    fail("cannot open the token file");
+    return 1;
+  }
+
+  // The ids are the words in order, with a break between documents
+  // but none after the last.
+  std::vector<std::string_view> expected;
+  std::size_t breaks = 0;
+  for (std::size_t i = 0; i < documents.size(); i++) {
+    if (i > 0) {
+      expected.push_back(std::string_view());
+      breaks++;
+    }
+    expected.insert(expected.end(), documents[i].begin(),
+                    documents[i].end());
+  }
+  if (f.size() != expected.size())
+    fail("the token count is wrong");
+  if (w.tokens() != expected.size() - breaks)
+    fail("the writer's token count is wrong");
+  if (f.words() != w.words().size())
+    fail("the word count is wrong");
+
+  vocabulary dict = f.dictionary();
+  std::size_t i = 0;
+  for (const token *t = f.begin(); t != f.end() && i < expected.size();
+       t++, i++) {
+    if (expected[i].empty()) {
+      if (*t != document_break)
+        fail("a document break is missing");
+    } else if (*t >= f.words() || f.word(*t) != expected[i]) {
+      fail("a word does not round trip");
+    } else if (w.words().find(expected[i]) != *t
+               || dict.find(expected[i]) != *t) {
+      fail("a word has a different id");
+    }
+  }
+
+  f.close();
+  std::remove(path.c_str());
+  return failures == 0 ? 0 : 1;
+}
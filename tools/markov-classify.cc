@@ -0,0 +1,150 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * markov-classify trains one chain per class and labels each document
+ * with the class whose chain gives it the highest likelihood.
+ */
+#include <config.h>
+#include <classify.hh>
+#include <compress.hh>
+#include "timer.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace markov;
+
+namespace {
+
+void usage(const char *prog)
+{
+  std::cerr << "usage: " << prog << " [-p prefix-len] [-s] [-T]"
+            << " -c label=file[,file...] ... document ..." << std::endl;
+  std::exit(EXIT_FAILURE);
+}
+
+bool reportErrors(const std::vector<std::string>& errors)
+{
+  for (std::size_t i = 0; i < errors.size(); i++)
+    std::cerr << errors[i] << ": cannot read" << std::endl;
+  return errors.empty();
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+  std::size_t prefix_len = 2;
+  bool show_scores = false;
+  bool timing = false;
+  std::vector<std::string> labels;
+  std::vector<std::vector<std::string> > training;
+
+  int opt;
+  while ((opt = ::getopt(argc, argv, "p:c:sT")) != -1) {
+    switch (opt) {
+    case 'p':
+      prefix_len = std::strtoul(optarg, NULL, 10);
+      if (prefix_len == 0)
+        usage(argv[0]);
+      break;
+    case 'c': {
+      std::string arg(optarg);
+      std::size_t eq = arg.find('=');
+      if (eq == std::string::npos || eq == 0 || eq + 1 == arg.size())
+        usage(argv[0]);
+      labels.push_back(arg.substr(0, eq));
+      std::vector<std::string> files;
+      std::size_t pos = eq + 1;
+      for (;;) {
+        std::size_t comma = arg.find(',', pos);
+        files.push_back(arg.substr(pos, comma - pos));
+        if (comma == std::string::npos)
+          break;
+        pos = comma + 1;
+      }
+      training.push_back(files);
+      break;
+    }
+    case 's':
+      show_scores = true;
+      break;
+    case 'T':
+      timing = true;
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+  if (labels.empty() || optind == argc)
+    usage(argv[0]);
+  std::vector<std::string> documents(argv + optind, argv + argc);
+
+  timer clock(timing);
+  bool ok = true;
+  classifier c(labels, prefix_len);
+  for (std::size_t i = 0; i < labels.size(); i++) {
+    compressed_reader reader(training[i]);
+    c.add(i, reader);
+    ok = reportErrors(reader.errors()) && ok;
+  }
+  clock.lap("train");
+
+  // All documents are read and scored in one pass.  Those that could
+  // not be read, or had no known words to score, get no label.
+  std::vector<double> scores;
+  std::vector<std::size_t> scored;
+  compressed_reader reader(documents);
+  c.score(reader, scores, &scored);
+  ok = reportErrors(reader.errors()) && ok;
+  scores.resize(documents.size() * c.classes(), 0);
+  scored.resize(documents.size(), 0);
+  double secs = clock.lap("classify");
+
+  std::set<std::string> unread(reader.errors().begin(),
+                               reader.errors().end());
+  for (std::size_t d = 0; d < documents.size(); d++) {
+    if (unread.count(documents[d]))
+      continue;
+    if (scored[d] == 0) {
+      std::cerr << documents[d] << ": no known words to classify"
+                << std::endl;
+      ok = false;
+      continue;
+    }
+    const double *s = &scores[d * c.classes()];
+    std::cout << documents[d] << '\t' << c.label(c.best(s));
+    if (show_scores)
+      for (std::size_t k = 0; k < c.classes(); k++)
+        std::cout << '\t' << s[k];
+    std::cout << '\n';
+  }
+  std::cout.flush();
+  if (secs > 0)
+    clock.note(reader.bytes() / secs / (1 << 20), "MiB/s");
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
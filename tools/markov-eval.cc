@@ -0,0 +1,143 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * markov-eval loads a chain written by markov-train and reports its
+ * perplexity on held-out text, along with how much of that text it
+ * has never seen.
+ */
+#include <config.h>
+#include <compress.hh>
+#include <evaluate.hh>
+#include <ingest.hh>
+#include "timer.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace markov;
+
+namespace {
+
+void usage(const char *prog)
+{
+  std::cerr << "usage: " << prog << " [-j threads] [-T] [-d directory]"
+            << " [-m manifest] model [file ...]" << std::endl;
+  std::exit(EXIT_FAILURE);
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned threads = 1;
+  bool timing = false;
+  std::vector<std::string> files;
+
+  int opt;
+  while ((opt = ::getopt(argc, argv, "j:Td:m:")) != -1) {
+    switch (opt) {
+    case 'j':
+      threads = std::strtoul(optarg, NULL, 10);
+      break;
+    case 'T':
+      timing = true;
+      break;
+    case 'd': {
+      // An empty list would fall back to standard input, so a missing
+      // or empty directory is an error rather than a silent wait.
+      std::vector<std::string> found = listDirectory(optarg);
+      if (found.empty()) {
+        std::cerr << optarg << ": no files to read" << std::endl;
+        return EXIT_FAILURE;
+      }
+      files.insert(files.end(), found.begin(), found.end());
+      break;
+    }
+    case 'm': {
+      std::ifstream manifest(optarg);
+      if (!manifest) {
+        std::perror(optarg);
+        return EXIT_FAILURE;
+      }
+      std::vector<std::string> listed = readManifest(manifest);
+      if (listed.empty()) {
+        std::cerr << optarg << ": no files listed" << std::endl;
+        return EXIT_FAILURE;
+      }
+      files.insert(files.end(), listed.begin(), listed.end());
+      break;
+    }
+    default:
+      usage(argv[0]);
+    }
+  }
+  if (optind >= argc)
+    usage(argv[0]);
+  const char *modelfile = argv[optind++];
+  files.insert(files.end(), argv + optind, argv + argc);
+
+  timer clock(timing);
+  model m;
+  std::ifstream in(modelfile);
+  if (!in) {
+    std::perror(modelfile);
+    return EXIT_FAILURE;
+  }
+  m.read(in);
+  if (m.size() == 0) {
+    std::cerr << modelfile << ": no chain entries" << std::endl;
+    return EXIT_FAILURE;
+  }
+  clock.lap("load");
+  smoothed_model sm(m);
+  clock.lap("smooth");
+
+  evaluation ev;
+  if (files.empty()) {
+    std::vector<std::string> input(1, "-");
+    compressed_reader reader(input);
+    ev = evaluate(sm, reader);
+    ev.errors = reader.errors();
+  }
+  else
+    ev = evaluate(sm, files, threads);
+  clock.lap("evaluate");
+
+  for (std::size_t i = 0; i < ev.errors.size(); i++)
+    std::cerr << ev.errors[i] << ": cannot read" << std::endl;
+
+  std::cout << "tokens: " << ev.tokens << '\n'
+            << "oov rate: " << ev.oovRate() << '\n'
+            << "dead-end rate: " << ev.deadEndRate() << '\n'
+            << "unseen rate: "
+            << (ev.scored ? static_cast<double>(ev.unseen) / ev.scored : 0)
+            << '\n'
+            << "perplexity: " << ev.perplexity() << std::endl;
+  if (ev.seconds > 0)
+    clock.note(ev.bytes / ev.seconds / (1 << 20), "MiB/s");
+
+  return ev.errors.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
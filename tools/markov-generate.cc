@@ -0,0 +1,289 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * markov-generate loads a chain written by markov-train (or
+ * chain::write) and writes generated text, one line per sample.  With
+ * a temperature, top-p, banned words or endings given, the chain is
+ * loaded as a model and sampled through a sampler instead.  With -j,
+ * it is loaded as a model and the samples are made in batches on
+ * several threads, each drawing from its own philox stream.
+ */
+#include <config.h>
+#include <chain.hh>
+#include <constraints.hh>
+#include <model.hh>
+#include <sampler.hh>
+#include <sink.hh>
+#include "timer.hh"
+#include "words.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace markov;
+
+namespace {
+
+void usage(const char *prog)
+{
+  std::cerr << "usage: " << prog
+            << " [-n words] [-c count] [-p prefix] [-s temperature]"
+            << " [-P top-p] [-b banned-words] [-e] [-k keyword] [-r seed]"
+            << " [-t] [-j threads] [-T]"
+            << " model"
+            << std::endl;
+  std::exit(EXIT_FAILURE);
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+  std::size_t nwords = 100;
+  unsigned long count = 1;
+  bool tryhard = false;
+  bool timing = false;
+  bool sampling = false;
+  double temperature = 1.0;
+  double top_p = 1.0;
+  const char *banfile = NULL;
+  const char *keyword = NULL;
+  bool sentences = false;
+  bool batched = false;
+  unsigned threads = 1;
+  bool seeded = false;
+  std::uint64_t seed = 0;
+  chain::prefix start;
+
+  int opt;
+  while ((opt = ::getopt(argc, argv, "n:c:p:s:P:b:ek:r:tj:T")) != -1) {
+    switch (opt) {
+    case 'n':
+      nwords = std::strtoul(optarg, NULL, 10);
+      break;
+    case 'c':
+      count = std::strtoul(optarg, NULL, 10);
+      break;
+    case 'p': {
+      std::istringstream words(optarg);
+      std::string w;
+      start.clear();
+      while (words >> w)
+        start.push_back(w);
+      break;
+    }
+    case 's':
+      temperature = std::strtod(optarg, NULL);
+      sampling = true;
+      break;
+    case 'P':
+      top_p = std::strtod(optarg, NULL);
+      if (!(top_p > 0 && top_p <= 1))
+        usage(argv[0]);
+      sampling = true;
+      break;
+    case 'b':
+      banfile = optarg;
+      sampling = true;
+      break;
+    case 'e':
+      sentences = true;
+      sampling = true;
+      break;
+    case 'k':
+      keyword = optarg;
+      sampling = true;
+      break;
+    case 'r':
+      seed = std::strtoul(optarg, NULL, 10);
+      seeded = true;
+      chain::setSeed(seed);
+      break;
+    case 't':
+      tryhard = true;
+      break;
+    case 'j':
+      threads = std::strtoul(optarg, NULL, 10);
+      batched = true;
+      break;
+    case 'T':
+      timing = true;
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+  if (optind != argc - 1)
+    usage(argv[0]);
+  if (batched && sampling) {
+    std::cerr << argv[0] << ": -j cannot be used with -s, -P, -b, -e or -k"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  timer clock(timing);
+  std::ifstream in(argv[optind]);
+  if (!in) {
+    std::perror(argv[optind]);
+    return EXIT_FAILURE;
+  }
+  // Long words are queued by pointer into the model's or chain's
+  // storage, so both must outlive the sink.
+  model m;
+  chain c;
+  fd_sink out(STDOUT_FILENO);
+
+  if (batched) {
+    m.read(in);
+    if (m.size() == 0) {
+      std::cerr << argv[optind] << ": no chain entries" << std::endl;
+      return EXIT_FAILURE;
+    }
+    m.freeze();
+    clock.lap("load");
+
+    std::vector<token> pref;
+    for (std::size_t i = 0; i < start.size(); i++)
+      pref.push_back(m.words().find(start[i]));
+    bool known = pref.size() == m.prefixLength()
+      && std::find(pref.begin(), pref.end(), no_token) == pref.end();
+    if (!seeded)
+      seed = chain::entropy();
+
+    // Sample k draws from stream k whatever the batch size, so the
+    // batches only bound the memory used.
+    std::size_t batch = std::max<std::size_t>(1, (1 << 22) / (nwords + 1));
+    std::vector<token> ids;
+    std::vector<std::size_t> lengths;
+    for (unsigned long first = 0; first < count && out.good();
+         first += batch) {
+      std::size_t n = std::min<unsigned long>(batch, count - first);
+      ids.resize(n * nwords);
+      lengths.resize(n);
+      m.generateBatch(seed, n, nwords, ids.data(), lengths.data(), tryhard,
+                      threads, known ? pref.data() : NULL, first);
+      for (std::size_t k = 0; k < n; k++) {
+        out.add(m.words(), ids.data() + k * nwords, lengths[k]);
+        if (lengths[k] > 0)
+          out.add(' ');
+        out.add('\n');
+      }
+    }
+  }
+  else if (sampling) {
+    m.read(in);
+    if (m.size() == 0) {
+      std::cerr << argv[optind] << ": no chain entries" << std::endl;
+      return EXIT_FAILURE;
+    }
+    m.freeze(keyword != NULL);
+    sampler gen(m);
+    gen.setTemperature(temperature);
+    gen.setTopP(top_p);
+
+    // The banned words are read from a file, separated by whitespace;
+    // words the model does not know cannot be generated anyway.
+    word_set banned(m.words().size());
+    if (banfile) {
+      std::ifstream bans(banfile);
+      if (!bans) {
+        std::perror(banfile);
+        return EXIT_FAILURE;
+      }
+      std::string w;
+      while (bans >> w)
+        banned.insert(m.words().find(w));
+    }
+    word_set terminals(m.words().size());
+    if (sentences)
+      for (std::size_t t = 0; t < m.words().size(); t++)
+        if (endsSentence(m.words().word(t)))
+          terminals.insert(t);
+    endings ends(m, terminals);
+    bool constrained = banfile || sentences;
+    token key = keyword ? m.words().find(keyword) : no_token;
+    if (keyword && key == no_token) {
+      std::cerr << keyword << ": not in " << argv[optind] << std::endl;
+      return EXIT_FAILURE;
+    }
+    if (keyword && m.randomState(key) == model::no_state) {
+      std::cerr << keyword << ": in no prefix of " << argv[optind]
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+    clock.lap("load");
+
+    // A prefix with a word the model has never seen starts from a
+    // random state, as an unknown prefix does for a chain.  A keyword
+    // starts each sample from a random prefix that contains it.
+    std::vector<token> pref;
+    for (std::size_t i = 0; i < start.size(); i++)
+      pref.push_back(m.words().find(start[i]));
+    bool known = pref.size() == m.prefixLength()
+      && std::find(pref.begin(), pref.end(), no_token) == pref.end();
+    std::vector<token> ids(nwords);
+    for (unsigned long i = 0; i < count && out.good(); i++) {
+      const token *p = known ? pref.data() : NULL;
+      if (keyword)
+        p = m.prefixOf(m.randomState(key));
+      std::size_t n = constrained
+        ? gen.generate(ids.data(), nwords, p, &banned,
+                       sentences ? &ends : NULL, tryhard)
+        : gen.generate(ids.data(), nwords, p, tryhard);
+      out.add(m.words(), ids.data(), n);
+      if (n > 0)
+        out.add(' ');
+      out.add('\n');
+    }
+  }
+  else {
+    c.read(in);
+    if (c.empty()) {
+      std::cerr << argv[optind] << ": no chain entries" << std::endl;
+      return EXIT_FAILURE;
+    }
+    clock.lap("load");
+
+    // Samples are gathered straight from the chain's words and written
+    // with writev in large pieces.
+    for (unsigned long i = 0; i < count && out.good(); i++)
+      c.generate(out, nwords, start, tryhard);
+  }
+  if (!out.flush()) {
+    std::perror("write");
+    return EXIT_FAILURE;
+  }
+  double secs = clock.lap("generate");
+
+  if (timing && secs > 0)
+    std::cerr << count / secs << " samples/s" << std::endl;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,236 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * markov-loadgen drives a running markovd with a number of concurrent
+ * connections, each with a configurable number of pipelined requests
+ * in flight, and reports throughput and latency percentiles.
+ */
+#include <config.h>
+#include "protocol.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace markov;
+
+namespace {
+
+typedef std::chrono::steady_clock clock_type;
+
+struct options {
+  std::string sockpath;
+  std::string prefix;
+  unsigned connections;
+  unsigned depth;
+  unsigned long requests;
+  std::uint32_t nwords;
+  std::uint32_t flags;
+};
+
+struct result {
+  std::vector<double> latencies;
+  unsigned long long bytes;
+  unsigned long errors;
+};
+
+void usage(const char *prog)
+{
+  std::cerr << "usage: " << prog << " [-s socket] [-c connections]"
+            << " [-d depth] [-r requests] [-n words] [-p prefix] [-t]"
+            << std::endl;
+  std::exit(EXIT_FAILURE);
+}
+
+int connectTo(const std::string& path)
+{
+  sockaddr_un addr;
+  if (path.size() >= sizeof(addr.sun_path))
+    return -1;
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  std::strcpy(addr.sun_path, path.c_str());
+  if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+    ::close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// One connection's worth of load: keep up to depth requests in flight
+// until the connection's share of the requests has been answered.
+void worker(const options& opt, unsigned long count, result& res)
+{
+  res.bytes = 0;
+  res.errors = 0;
+  int fd = connectTo(opt.sockpath);
+  if (fd < 0) {
+    res.errors = count;
+    return;
+  }
+
+  std::string req(sizeof(protocol::request_header), '\0');
+  protocol::request_header hdr;
+  hdr.magic = protocol::request_magic;
+  hdr.nwords = opt.nwords;
+  hdr.flags = opt.flags;
+  hdr.prefix_bytes = static_cast<std::uint32_t>(opt.prefix.size());
+  std::memcpy(&req[0], &hdr, sizeof(hdr));
+  req += opt.prefix;
+
+  std::deque<clock_type::time_point> sent;
+  std::vector<char> body;
+  unsigned long issued = 0, done = 0;
+  res.latencies.reserve(count);
+
+  while (done < count) {
+    while (issued < count && sent.size() < opt.depth) {
+      sent.push_back(clock_type::now());
+      if (!protocol::writeFull(fd, req.data(), req.size()))
+        goto fail;
+      issued++;
+    }
+
+    protocol::response_header rsp;
+    if (!protocol::readFull(fd, &rsp, sizeof(rsp))
+        || rsp.magic != protocol::response_magic)
+      goto fail;
+    body.resize(rsp.length);
+    if (rsp.length > 0 && !protocol::readFull(fd, &body[0], rsp.length))
+      goto fail;
+
+    std::chrono::duration<double, std::micro> us =
+      clock_type::now() - sent.front();
+    sent.pop_front();
+    done++;
+    if (rsp.status != protocol::status_ok)
+      res.errors++;
+    res.latencies.push_back(us.count());
+    res.bytes += rsp.length;
+  }
+  ::close(fd);
+  return;
+
+fail:
+  res.errors += count - done;
+  ::close(fd);
+}
+
+double percentile(const std::vector<double>& sorted, double p)
+{
+  if (sorted.empty())
+    return 0.0;
+  std::size_t i = static_cast<std::size_t>(p * (sorted.size() - 1) + 0.5);
+  return sorted[i];
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+  options opt;
+  opt.sockpath = "/tmp/markovd.sock";
+  opt.connections = 8;
+  opt.depth = 1;
+  opt.requests = 10000;
+  opt.nwords = 50;
+  opt.flags = 0;
+
+  int c;
+  while ((c = ::getopt(argc, argv, "s:c:d:r:n:p:t")) != -1) {
+    switch (c) {
+    case 's':
+      opt.sockpath = optarg;
+      break;
+    case 'c':
+      opt.connections = std::strtoul(optarg, NULL, 10);
+      break;
+    case 'd':
+      opt.depth = std::strtoul(optarg, NULL, 10);
+      break;
+    case 'r':
+      opt.requests = std::strtoul(optarg, NULL, 10);
+      break;
+    case 'n':
+      opt.nwords = std::strtoul(optarg, NULL, 10);
+      break;
+    case 'p':
+      opt.prefix = optarg;
+      break;
+    case 't':
+      opt.flags |= protocol::flag_tryhard;
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+  if (optind != argc || opt.connections == 0 || opt.depth == 0)
+    usage(argv[0]);
+
+  std::vector<result> results(opt.connections);
+  std::vector<std::thread> threads;
+  clock_type::time_point start = clock_type::now();
+  for (unsigned i = 0; i < opt.connections; i++) {
+    unsigned long share = opt.requests / opt.connections
+      + (i < opt.requests % opt.connections ? 1 : 0);
+    threads.push_back(std::thread(worker, std::cref(opt), share,
+                                  std::ref(results[i])));
+  }
+  for (std::size_t i = 0; i < threads.size(); i++)
+    threads[i].join();
+  std::chrono::duration<double> elapsed = clock_type::now() - start;
+
+  std::vector<double> all;
+  unsigned long long bytes = 0;
+  unsigned long errors = 0;
+  for (std::size_t i = 0; i < results.size(); i++) {
+    all.insert(all.end(), results[i].latencies.begin(),
+               results[i].latencies.end());
+    bytes += results[i].bytes;
+    errors += results[i].errors;
+  }
+  std::sort(all.begin(), all.end());
+
+  std::cout << std::fixed << std::setprecision(1)
+            << "requests:   " << all.size() << " (" << errors << " errors)\n"
+            << "elapsed:    " << elapsed.count() << " s\n"
+            << "throughput: " << all.size() / elapsed.count() << " req/s, "
+            << bytes / elapsed.count() / (1 << 20) << " MiB/s\n"
+            << "latency:    p50 " << percentile(all, 0.50) << " us, p99 "
+            << percentile(all, 0.99) << " us, max "
+            << (all.empty() ? 0.0 : all.back()) << " us" << std::endl;
+
+  return errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
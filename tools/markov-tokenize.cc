@@ -0,0 +1,130 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * markov-tokenize converts a text corpus into a token file, which
+ * markov-train can then train on at any prefix length without
+ * tokenizing the text again.
+ */
+#include <config.h>
+#include <compress.hh>
+#include <ingest.hh>
+#include <tokens.hh>
+#include "timer.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace markov;
+
+namespace {
+
+void usage(const char *prog)
+{
+  std::cerr << "usage: " << prog << " -o output [-T] [-d directory]"
+            << " [-m manifest] [file ...]" << std::endl;
+  std::exit(EXIT_FAILURE);
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+  std::string output;
+  bool timing = false;
+  std::vector<std::string> files;
+
+  int opt;
+  while ((opt = ::getopt(argc, argv, "o:Td:m:")) != -1) {
+    switch (opt) {
+    case 'o':
+      output = optarg;
+      break;
+    case 'T':
+      timing = true;
+      break;
+    case 'd': {
+      // An empty list would fall back to standard input, so a missing
+      // or empty directory is an error rather than a silent wait.
+      std::vector<std::string> found = listDirectory(optarg);
+      if (found.empty()) {
+        std::cerr << optarg << ": no files to read" << std::endl;
+        return EXIT_FAILURE;
+      }
+      files.insert(files.end(), found.begin(), found.end());
+      break;
+    }
+    case 'm': {
+      std::ifstream manifest(optarg);
+      if (!manifest) {
+        std::perror(optarg);
+        return EXIT_FAILURE;
+      }
+      std::vector<std::string> listed = readManifest(manifest);
+      if (listed.empty()) {
+        std::cerr << optarg << ": no files listed" << std::endl;
+        return EXIT_FAILURE;
+      }
+      files.insert(files.end(), listed.begin(), listed.end());
+      break;
+    }
+    default:
+      usage(argv[0]);
+    }
+  }
+  if (output.empty())
+    usage(argv[0]);
+  files.insert(files.end(), argv + optind, argv + argc);
+  if (files.empty())
+    files.push_back("-");
+
+  timer clock(timing);
+  token_writer writer(output);
+  if (!writer.good()) {
+    std::perror(output.c_str());
+    return EXIT_FAILURE;
+  }
+
+  // The reader decompresses if need be and passes plain text through.
+  compressed_reader reader(files);
+  writer.add(reader);
+  bool ok = true;
+  for (std::size_t i = 0; i < reader.errors().size(); i++) {
+    std::cerr << reader.errors()[i] << ": cannot read" << std::endl;
+    ok = false;
+  }
+  if (!writer.close()) {
+    std::cerr << output << ": write failed" << std::endl;
+    return EXIT_FAILURE;
+  }
+  double secs = clock.lap("tokenize");
+
+  if (timing && secs > 0)
+    std::cerr << writer.tokens() << " tokens, " << writer.words().size()
+              << " words, " << reader.bytes() / secs / (1 << 20)
+              << " MiB/s" << std::endl;
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,272 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * markov-train builds a chain from text files (or standard input) and
+ * writes it in the format read by chain::read.  With -s it trains a
+ * model with sentence breaks instead, whose output also lists the
+ * states that start sentences.
+ */
+#include <config.h>
+#include <chain.hh>
+#include <compress.hh>
+#include <corpus.hh>
+#include <ingest.hh>
+#include <model.hh>
+#include <tokens.hh>
+#include "timer.hh"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace markov;
+
+namespace {
+
+void usage(const char *prog)
+{
+  std::cerr << "usage: " << prog
+            << " [-p prefix-len] [-j threads] [-r] [-s] [-o output] [-T]"
+            << " [-d directory] [-m manifest] [file ...]" << std::endl;
+  std::exit(EXIT_FAILURE);
+}
+
+// Report files that could not be read; returns false if there were any.
+bool reportErrors(const std::vector<std::string>& errors)
+{
+  for (std::size_t i = 0; i < errors.size(); i++)
+    std::cerr << errors[i] << ": cannot read" << std::endl;
+  return errors.empty();
+}
+
+// Write a chain or model to the output file, or standard output.
+template <class T>
+bool writeOut(T& m, const std::string& output)
+{
+  if (output.empty()) {
+    m.write(std::cout);
+    return std::cout.good();
+  }
+  std::ofstream out(output);
+  if (!out) {
+    std::perror(output.c_str());
+    return false;
+  }
+  m.write(out);
+  return out.good();
+}
+
+// Train on text files on one thread, reading ahead across them, or
+// through the decompressing reader when any are compressed.  Standard
+// input may be compressed too, so it always goes through that reader.
+template <class T>
+bool trainText(T& m, std::vector<std::string> files, bool resetprefix,
+               bool timing, timer& clock)
+{
+  bool compressed = files.empty();
+  for (std::size_t i = 0; i < files.size(); i++)
+    if (compressed_reader::compressedName(files[i]))
+      compressed = true;
+
+  if (compressed) {
+    if (files.empty())
+      files.push_back("-");
+    compressed_reader reader(files);
+    m.add(reader, resetprefix);
+    double secs = clock.lap("train");
+    bool ok = reportErrors(reader.errors());
+    if (timing && secs > 0)
+      std::cerr << reader.bytes() / secs / (1 << 20)
+                << " MiB/s decompressed" << std::endl;
+    return ok;
+  }
+
+  corpus_reader reader(files);
+  m.add(reader, resetprefix);
+  double secs = clock.lap("train");
+  bool ok = reportErrors(reader.errors());
+  if (timing && secs > 0)
+    std::cerr << reader.bytes() / secs / (1 << 20) << " MiB/s read with "
+              << reader.backend() << std::endl;
+  return ok;
+}
+
+// Train on token files written by markov-tokenize.  The words stay ids
+// until the model is written out.
+int trainTokens(const std::vector<std::string>& files, std::size_t prefixlen,
+                bool resetprefix, bool sentences, const std::string& output,
+                timer& clock)
+{
+  model m(prefixlen);
+  m.setSentenceBreaks(sentences);
+  bool ok = true;
+  unsigned long long ntokens = 0;
+  for (std::size_t i = 0; i < files.size(); i++) {
+    token_file f;
+    if (!f.open(files[i])) {
+      std::cerr << files[i] << ": not a token file" << std::endl;
+      ok = false;
+      continue;
+    }
+    if (resetprefix)
+      m.reset();
+    m.add(f, resetprefix);
+    ntokens += f.size();
+  }
+  double secs = clock.lap("train");
+  if (secs > 0)
+    clock.note(ntokens / secs, "tokens/s");
+
+  if (!writeOut(m, output))
+    return EXIT_FAILURE;
+  clock.lap("write");
+  clock.note(m.size(), "prefixes");
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+  std::size_t prefixlen = 2;
+  unsigned nthreads = 1;
+  bool resetprefix = false;
+  bool sentences = false;
+  bool timing = false;
+  std::string output;
+  std::vector<std::string> files;
+
+  int opt;
+  while ((opt = ::getopt(argc, argv, "p:j:rso:Td:m:")) != -1) {
+    switch (opt) {
+    case 'p':
+      prefixlen = std::strtoul(optarg, NULL, 10);
+      break;
+    case 'j':
+      nthreads = std::strtoul(optarg, NULL, 10);
+      break;
+    case 'r':
+      resetprefix = true;
+      break;
+    case 's':
+      sentences = true;
+      break;
+    case 'o':
+      output = optarg;
+      break;
+    case 'T':
+      timing = true;
+      break;
+    case 'd': {
+      // An empty list would fall back to standard input, so a missing
+      // or empty directory is an error rather than a silent wait.
+      std::vector<std::string> found = listDirectory(optarg);
+      if (found.empty()) {
+        std::cerr << optarg << ": no files to train on" << std::endl;
+        return EXIT_FAILURE;
+      }
+      files.insert(files.end(), found.begin(), found.end());
+      break;
+    }
+    case 'm': {
+      std::ifstream manifest(optarg);
+      if (!manifest) {
+        std::perror(optarg);
+        return EXIT_FAILURE;
+      }
+      std::vector<std::string> listed = readManifest(manifest);
+      if (listed.empty()) {
+        std::cerr << optarg << ": no files listed" << std::endl;
+        return EXIT_FAILURE;
+      }
+      files.insert(files.end(), listed.begin(), listed.end());
+      break;
+    }
+    default:
+      usage(argv[0]);
+    }
+  }
+  if (prefixlen == 0)
+    usage(argv[0]);
+  if (sentences && nthreads != 1) {
+    std::cerr << argv[0] << ": -s cannot be used with -j" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  files.insert(files.end(), argv + optind, argv + argc);
+  timer clock(timing);
+
+  std::size_t ntokfiles = 0;
+  for (std::size_t i = 0; i < files.size(); i++)
+    if (token_file::check(files[i]))
+      ntokfiles++;
+  if (ntokfiles > 0) {
+    if (ntokfiles != files.size()) {
+      std::cerr << argv[0] << ": cannot mix token files and text"
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+    return trainTokens(files, prefixlen, resetprefix, sentences, output,
+                       clock);
+  }
+
+  if (sentences) {
+    model m(prefixlen);
+    m.setSentenceBreaks(true);
+    bool ok = trainText(m, files, resetprefix, timing, clock);
+    if (!writeOut(m, output))
+      return EXIT_FAILURE;
+    clock.lap("write");
+    clock.note(m.size(), "prefixes");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  chain c(prefixlen);
+  bool ok = true;
+
+  if (nthreads == 1 || files.size() <= 1)
+    ok = trainText(c, files, resetprefix, timing, clock);
+  else {
+    // Files are trained apart, then joined up unless -r was given, so
+    // the thread count does not change the chain.
+    ingest_stats stats = ingest(c, files, nthreads, 64, resetprefix);
+    clock.lap("train");
+    ok = reportErrors(stats.errors);
+    if (timing)
+      std::cerr << stats.files << " files, " << stats.filesPerSecond()
+                << " files/s, " << stats.megabytesPerSecond() << " MiB/s"
+                << std::endl;
+  }
+
+  if (!writeOut(c, output))
+    return EXIT_FAILURE;
+  clock.lap("write");
+
+  if (timing)
+    std::cerr << c.size() << " prefixes, " << clock.total() << " s total"
+              << std::endl;
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
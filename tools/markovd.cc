@@ -0,0 +1,391 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * markovd loads a model once and serves generate requests over a Unix
+ * domain socket.  It runs a single poll loop: every request that has
+ * arrived on any connection by the time poll returns is collected into
+ * one batch, the batch is generated, and each connection's responses
+ * are queued in an fd_sink that points straight at the model's words.
+ * Batching rather than threading is how the daemon keeps up with
+ * concurrent clients.  A model trained with sentence breaks starts
+ * each answer at the start of a sentence.
+ *
+ * Sockets are non-blocking.  A queue is written as far as the socket
+ * takes it and the rest when poll says the socket is writable, so a
+ * client that does not read its replies holds up only itself: once
+ * its queue passes a limit, no more of its requests are read until it
+ * catches up.
+ *
+ * Each request draws from its own philox stream, numbered in the order
+ * the daemon takes requests, so reseeding costs nothing per request.
+ * With -S the seed is fixed and a run of requests is answered the same
+ * every time.
+ */
+#include <config.h>
+#include <chain.hh>
+#include <model.hh>
+#include <philox.hh>
+#include <sink.hh>
+#include "protocol.hh"
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace markov;
+
+namespace {
+
+volatile std::sig_atomic_t stopping = 0;
+
+// A client stops being read once it has this many bytes of replies
+// waiting, or this many bytes of requests not yet parsed.  The input
+// limit is well above the largest request.
+const std::size_t max_pending = 4 << 20;
+const std::size_t max_input = 1 << 20;
+
+void onSignal(int)
+{
+  stopping = 1;
+}
+
+struct client {
+  int fd;
+  std::string in;
+  std::unique_ptr<fd_sink> out;
+  bool dead;
+};
+
+struct job {
+  std::size_t client;
+  protocol::response_header hdr;
+  std::uint32_t nwords;
+  bool tryhard;
+  chain::prefix pref;
+};
+
+void usage(const char *prog)
+{
+  std::cerr << "usage: " << prog
+            << " [-s socket] [-b max-batch] [-S seed] [-v] model"
+            << std::endl;
+  std::exit(EXIT_FAILURE);
+}
+
+int listenOn(const std::string& path)
+{
+  sockaddr_un addr;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    std::cerr << "socket path too long: " << path << std::endl;
+    return -1;
+  }
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0) {
+    std::perror("socket");
+    return -1;
+  }
+  std::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  std::strcpy(addr.sun_path, path.c_str());
+  ::unlink(path.c_str());
+  if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0
+      || ::listen(fd, SOMAXCONN) < 0) {
+    std::perror(path.c_str());
+    ::close(fd);
+    return -1;
+  }
+  ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+  return fd;
+}
+
+// Pull every complete request out of a client's input buffer, up to
+// the batch limit.  A malformed header marks the client dead, since
+// there is no way to resynchronize the stream.
+void parseRequests(std::vector<client>& clients, std::size_t ci,
+                   std::vector<job>& batch, std::size_t maxbatch)
+{
+  client& c = clients[ci];
+  std::size_t pos = 0;
+  while (batch.size() < maxbatch
+         && c.in.size() - pos >= sizeof(protocol::request_header)) {
+    protocol::request_header req;
+    std::memcpy(&req, c.in.data() + pos, sizeof(req));
+    if (req.magic != protocol::request_magic
+        || req.prefix_bytes > protocol::max_prefix_bytes) {
+      c.dead = true;
+      return;
+    }
+    if (c.in.size() - pos < sizeof(req) + req.prefix_bytes)
+      break;
+
+    job j;
+    j.client = ci;
+    j.hdr.magic = protocol::response_magic;
+    j.hdr.status = protocol::status_ok;
+    j.hdr.length = 0;
+    j.hdr.reserved = 0;
+    j.nwords = req.nwords;
+    j.tryhard = (req.flags & protocol::flag_tryhard) != 0;
+    if (req.nwords > protocol::max_words)
+      j.hdr.status = protocol::status_bad_request;
+
+    std::istringstream words(c.in.substr(pos + sizeof(req),
+                                         req.prefix_bytes));
+    std::string w;
+    while (words >> w)
+      j.pref.push_back(w);
+
+    batch.push_back(j);
+    pos += sizeof(req) + req.prefix_bytes;
+  }
+  c.in.erase(0, pos);
+}
+
+// True if a complete request is waiting in the client's buffer.
+bool hasRequest(const client& c)
+{
+  protocol::request_header req;
+  if (c.in.size() < sizeof(req))
+    return false;
+  std::memcpy(&req, c.in.data(), sizeof(req));
+  return c.in.size() - sizeof(req) >= req.prefix_bytes;
+}
+
+// True if the client is keeping up with its replies, so more of its
+// requests may be taken.
+bool keepingUp(const client& c)
+{
+  return !c.dead && c.out->pending() < max_pending;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+  std::string sockpath = "/tmp/markovd.sock";
+  std::size_t maxbatch = 256;
+  bool verbose = false;
+  std::uint64_t seed = 0;
+  bool seeded = false;
+
+  int opt;
+  while ((opt = ::getopt(argc, argv, "s:b:S:v")) != -1) {
+    switch (opt) {
+    case 's':
+      sockpath = optarg;
+      break;
+    case 'b':
+      maxbatch = std::strtoul(optarg, NULL, 10);
+      if (maxbatch == 0)
+        usage(argv[0]);
+      break;
+    case 'S':
+      seed = std::strtoull(optarg, NULL, 10);
+      seeded = true;
+      break;
+    case 'v':
+      verbose = true;
+      break;
+    default:
+      usage(argv[0]);
+    }
+  }
+  if (optind != argc - 1)
+    usage(argv[0]);
+
+  model m;
+  std::ifstream in(argv[optind]);
+  if (!in) {
+    std::perror(argv[optind]);
+    return EXIT_FAILURE;
+  }
+  m.read(in);
+  if (m.size() == 0) {
+    std::cerr << argv[optind] << ": no chain entries" << std::endl;
+    return EXIT_FAILURE;
+  }
+  m.freeze();
+  if (!seeded)
+    seed = chain::entropy();
+  philox rng;
+
+  int lfd = listenOn(sockpath);
+  if (lfd < 0)
+    return EXIT_FAILURE;
+
+  struct sigaction sa;
+  std::memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = onSignal;
+  ::sigaction(SIGINT, &sa, NULL);
+  ::sigaction(SIGTERM, &sa, NULL);
+  std::signal(SIGPIPE, SIG_IGN);
+
+  std::vector<client> clients;
+  std::vector<pollfd> fds;
+  std::vector<job> batch;
+  std::vector<token> ids;
+  std::vector<token> pref;
+  std::unique_ptr<char[]> rbuf(new char[1 << 16]);
+  unsigned long long nrequests = 0, nbatches = 0;
+  bool backlog = false;
+
+  while (!stopping) {
+    fds.clear();
+    fds.push_back(pollfd{lfd, POLLIN, 0});
+    for (std::size_t i = 0; i < clients.size(); i++) {
+      const client& cl = clients[i];
+      short events = 0;
+      if (keepingUp(cl) && cl.in.size() < max_input)
+        events |= POLLIN;
+      if (cl.out->pending() > 0)
+        events |= POLLOUT;
+      fds.push_back(pollfd{cl.fd, events, 0});
+    }
+
+    // Requests left over from a full batch are already buffered, so
+    // don't sleep waiting for more input.
+    if (::poll(&fds[0], fds.size(), backlog ? 0 : -1) < 0) {
+      if (errno == EINTR)
+        continue;
+      std::perror("poll");
+      break;
+    }
+
+    if (fds[0].revents & POLLIN) {
+      int cfd;
+      while ((cfd = ::accept(lfd, NULL, NULL)) >= 0) {
+        ::fcntl(cfd, F_SETFL, ::fcntl(cfd, F_GETFL) | O_NONBLOCK);
+        clients.push_back(client{cfd, std::string(),
+                                 std::unique_ptr<fd_sink>(
+                                   new fd_sink(cfd, 1 << 16)),
+                                 false});
+      }
+    }
+
+    batch.clear();
+    for (std::size_t i = 0; i < clients.size(); i++) {
+      client& cl = clients[i];
+      short revents = i + 1 < fds.size() ? fds[i + 1].revents : 0;
+      if ((revents & POLLOUT) && !cl.out->flush())
+        cl.dead = true;
+      if (revents & POLLERR)
+        cl.dead = true;
+      if (!cl.dead && (revents & (POLLIN | POLLHUP))
+          && cl.in.size() < max_input) {
+        ssize_t n = ::read(cl.fd, rbuf.get(), 1 << 16);
+        if (n > 0)
+          cl.in.append(rbuf.get(), n);
+        else if (n == 0 || (errno != EINTR && errno != EAGAIN
+                            && errno != EWOULDBLOCK))
+          cl.dead = true;
+      }
+      if (keepingUp(cl))
+        parseRequests(clients, i, batch, maxbatch);
+    }
+
+    backlog = false;
+    for (std::size_t i = 0; i < clients.size(); i++)
+      if (keepingUp(clients[i]) && hasRequest(clients[i]))
+        backlog = true;
+
+    if (!batch.empty()) {
+      nbatches++;
+      // The header goes first, so the words are generated before any
+      // of them are queued, to know the length.  They are queued by
+      // reference into the model's vocabulary, which does not change.
+      // A prefix the model does not know starts at random.
+      for (std::vector<job>::iterator j = batch.begin(); j != batch.end();
+           j++) {
+        rng.seed(seed, nrequests++);
+        fd_sink& out = *clients[j->client].out;
+        std::size_t n = 0;
+        if (j->hdr.status == protocol::status_ok) {
+          pref.clear();
+          for (std::size_t w = 0; w < j->pref.size(); w++)
+            pref.push_back(m.words().find(j->pref[w]));
+          bool known = pref.size() == m.prefixLength()
+            && std::find(pref.begin(), pref.end(), no_token) == pref.end();
+          ids.resize(j->nwords);
+          n = m.generate(ids.data(), j->nwords, known ? pref.data() : NULL,
+                         j->tryhard, rng);
+          std::size_t len = 1;
+          for (std::size_t w = 0; w < n; w++)
+            len += m.words().word(ids[w]).size() + 1;
+          j->hdr.length = static_cast<std::uint32_t>(len);
+        }
+        out.add(std::string_view(reinterpret_cast<const char *>(&j->hdr),
+                                 sizeof(j->hdr)));
+        if (j->hdr.status != protocol::status_ok)
+          continue;
+        for (std::size_t w = 0; w < n; w++) {
+          out.add(m.words().word(ids[w]));
+          out.add(' ');
+        }
+        out.add('\n');
+      }
+
+      for (std::size_t i = 0; i < clients.size(); i++)
+        if (!clients[i].dead && clients[i].out->pending() > 0
+            && !clients[i].out->flush())
+          clients[i].dead = true;
+    }
+
+    std::size_t keep = 0;
+    for (std::size_t i = 0; i < clients.size(); i++) {
+      if (clients[i].dead) {
+        clients[i].out.reset();
+        ::close(clients[i].fd);
+      }
+      else if (keep++ != i)
+        clients[keep - 1] = std::move(clients[i]);
+    }
+    clients.resize(keep);
+  }
+
+  for (std::size_t i = 0; i < clients.size(); i++) {
+    clients[i].out.reset();
+    ::close(clients[i].fd);
+  }
+  ::close(lfd);
+  ::unlink(sockpath.c_str());
+
+  if (verbose && nbatches > 0)
+    std::cerr << nrequests << " requests in " << nbatches << " batches ("
+              << static_cast<double>(nrequests) / nbatches
+              << " per batch)" << std::endl;
+
+  return EXIT_SUCCESS;
+}
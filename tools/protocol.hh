@@ -0,0 +1,100 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MARKOV_PROTOCOL_HH_INCL
+#define MARKOV_PROTOCOL_HH_INCL
+
+#include <cstdint>
+#include <cerrno>
+#include <unistd.h>
+
+/*
+ * Wire format shared by markovd and markov-loadgen.
+ *
+ * Both ends live on the same host, so integers are sent in host byte
+ * order.  A request is a fixed header followed by prefix_bytes of
+ * space separated prefix words.  An empty prefix asks the server to
+ * start from a random prefix.  A response is a fixed header followed
+ * by length bytes of generated text.  Requests on one connection are
+ * answered in order, so a client may pipeline them.
+ */
+namespace markov {
+namespace protocol {
+
+const std::uint32_t request_magic = 0x314b564d;   // "MVK1"
+const std::uint32_t response_magic = 0x324b564d;  // "MVK2"
+
+const std::uint32_t flag_tryhard = 1;
+
+const std::uint32_t status_ok = 0;
+const std::uint32_t status_bad_request = 1;
+
+const std::uint32_t max_prefix_bytes = 1 << 16;
+const std::uint32_t max_words = 1 << 20;
+
+struct request_header {
+  std::uint32_t magic;
+  std::uint32_t nwords;
+  std::uint32_t flags;
+  std::uint32_t prefix_bytes;
+};
+
+struct response_header {
+  std::uint32_t magic;
+  std::uint32_t status;
+  std::uint32_t length;
+  std::uint32_t reserved;
+};
+
+// Read exactly len bytes, retrying on short reads.  Returns false on
+// end of file or error.
+inline bool readFull(int fd, void *buf, std::size_t len)
+{
+  char *p = static_cast<char *>(buf);
+  while (len > 0) {
+    ssize_t n = ::read(fd, p, len);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    p += n;
+    len -= n;
+  }
+  return true;
+}
+
+// Write exactly len bytes, retrying on short writes.
+inline bool writeFull(int fd, const void *buf, std::size_t len)
+{
+  const char *p = static_cast<const char *>(buf);
+  while (len > 0) {
+    ssize_t n = ::write(fd, p, len);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    p += n;
+    len -= n;
+  }
+  return true;
+}
+
+}
+}
+
+#endif // MARKOV_PROTOCOL_HH_INCL
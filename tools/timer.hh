@@ -0,0 +1,69 @@
+/*
+ * Copyright © 2026 Jason J.A. Stephenson <jason@sigio.com>
+ *
+ * This file is part of markov.
+ *
+ * markov is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * markov is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with markov.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MARKOV_TIMER_HH_INCL
+#define MARKOV_TIMER_HH_INCL
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+namespace markov {
+
+// Wall clock phase timer for the command line tools' -T output.
+class timer {
+public:
+  typedef std::chrono::steady_clock clock_type;
+
+  explicit timer(bool enabled) :
+    enabled(enabled), start(clock_type::now()), last(start) {}
+
+  // Report the time since the previous lap, if enabled, and return it
+  // in seconds.
+  double lap(const char *what) {
+    clock_type::time_point now = clock_type::now();
+    std::chrono::duration<double> d = now - this->last;
+    this->last = now;
+    if (this->enabled)
+      std::cerr << what << ": " << std::fixed << std::setprecision(3)
+                << d.count() << " s" << std::endl;
+    return d.count();
+  }
+
+  // Report a figure, if enabled.
+  void note(double value, const char *what) const {
+    if (this->enabled)
+      std::cerr << std::fixed << std::setprecision(1) << value << ' '
+                << what << std::endl;
+  }
+
+  // Seconds since construction.
+  double total() const {
+    std::chrono::duration<double> d = clock_type::now() - this->start;
+    return d.count();
+  }
+
+private:
+  bool enabled;
+  clock_type::time_point start;
+  clock_type::time_point last;
+};
+
+}
+
+#endif // MARKOV_TIMER_HH_INCL